@@ -10,6 +10,7 @@ struct menu_t;
 struct menu_item_t;
 struct device;
 struct menu_group_t;
+struct pannel_image;
 
 typedef enum {
     INPUT_TYPE_NONE = 0,
@@ -105,6 +106,9 @@ typedef enum {
     MENU_ITEM_TYPE_INPUT_MIN_MAX,
     MENU_ITEM_TYPE_LABEL,
    MENU_ITEM_TYPE_DIALOG,
+    MENU_ITEM_TYPE_PLOT,
+    MENU_ITEM_TYPE_BAR,
+    MENU_ITEM_TYPE_GAUGE,
 } menu_item_type_t;
 
 #define ADC_FILTER_WINDOW_SIZE 10
@@ -124,6 +128,7 @@ struct menu_item_t {
     void *priv_data;
     struct menu_group_t *group;
     bool visible;
+    uint16_t layout_y;
     struct menu_t *menu;
     menu_item_type_t type;
     union {
@@ -138,9 +143,7 @@ struct menu_item_t {
             const struct device *dev;
             menu_item_input_cb_t cb;
             menu_item_label_cb value_get_str_cb;
-            struct k_work work;
-            uint16_t *values;
-            size_t values_count;
+            struct k_work_delayable work;
             char rendered_value_str[16];
             uint16_t filter_window[ADC_FILTER_WINDOW_SIZE];
             uint8_t filter_index;
@@ -169,12 +172,37 @@ struct menu_item_t {
             char rendered_value_str[16];
             const char *text_on;
             const char *text_off;
-            uint16_t img_width;
-            uint16_t img_height;
+            const struct pannel_image *img_on;
+            const struct pannel_image *img_off;
         } checkbox;
         struct item_label_t {
             char rendered_label_str[32];
         } label;
+        /*
+         * Sweep chart, one column per sample. A new sample is drawn in its
+         * own column and the next one is blanked as the cursor, so an update
+         * repaints two columns. samples holds width entries.
+         */
+        struct item_plot_t {
+            int32_t *samples;
+            uint16_t width;
+            uint16_t height;
+            int32_t min;
+            int32_t max;
+            uint32_t count;
+        } plot;
+        /*
+         * Horizontal bar or radial gauge of value between min and max. The
+         * level last drawn is kept, an update repaints the strip between it
+         * and the new one, or the box around the old and new needle.
+         */
+        struct item_bar_t {
+            int32_t value;
+            int32_t min;
+            int32_t max;
+            uint16_t radius;
+            uint16_t rendered_level;
+        } bar;
     };
    struct item_dialog_t {
        char title[32];
@@ -207,6 +235,8 @@ struct menu_group_t {
     bool always_visible;
     uint32_t align;
     uint32_t item_text_align;
+    uint32_t style;
+    bool layout_valid;
     struct menu_t *menu;
 };
 
@@ -218,11 +248,13 @@ struct menu_update_msg {
 #define MENU_UPDATE_MSGQ_MAX_MSGS 10
 
 struct menu_t;
+struct mc_t;
 
 extern struct menu_t *menu_create(const struct device *render_dev);
 extern void menu_item_queue_update(struct menu_item_t *item, int32_t value);
 extern int menu_sensor_bind(struct menu_t *menu, const struct device *dev);
 extern int menu_item_add(struct menu_t *menu, struct menu_item_t *item, uint8_t parent);
+extern struct menu_item_t *menu_item_find(struct menu_t *menu, uint8_t id);
 extern int menu_input_event(struct menu_t *menu, menu_input_event_t *event);
 extern void menu_set_current_item(struct menu_t *menu, struct menu_item_t *item);
 extern struct menu_item_t *menu_get_current_item(struct menu_t *menu);
@@ -235,12 +267,14 @@ extern void menu_group_bind_item(struct menu_group_t *group, struct menu_item_t
 extern void menu_group_set_always_visible(struct menu_group_t *group, bool always_visible);
 extern void menu_group_set_align(struct menu_group_t *group, uint32_t align);
 extern void menu_group_set_item_text_align(struct menu_group_t *group, uint32_t align);
+extern void menu_group_set_style(struct menu_group_t *group, uint32_t style);
 extern void menu_set_main_group(struct menu_t *menu, struct menu_group_t *group);
 extern void menu_item_refresh(struct menu_item_t *item);
 extern bool menu_item_is_editing(struct menu_item_t *item);
 extern void menu_disable_qdec(struct menu_t *menu, bool disable);
 extern void menu_driver_bind(struct menu_t *menu, void *driver);
 extern int menu_init(const struct device *dev, struct menu_t **out);
+extern int menu_status_bind(struct mc_t *mc);
 extern void menu_driver_start(struct menu_t *menu, void (*start)(void *, bool), bool en);
 extern void *menu_driver_get(struct menu_t *menu);
 extern int menu_dialog_show(struct menu_t *menu, menu_dialog_style_t style, const char *title, menu_dialog_confirm_cb_t cb, const char *fmt, ...);
\ No newline at end of file
@@ -8,11 +8,39 @@ struct device;
 struct display_capabilities;
 struct pannel_t;
 
+struct pannel_rect {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+};
+
+/*
+ * Run-length coded 16-bit image, made from a PNG by scripts/img2rle.py.
+ * data is a stream of packets over the rows, a header byte holds the
+ * pixel count minus one in the low 7 bits, with the top bit set one pixel
+ * follows for the whole run, otherwise count pixels follow, little endian.
+ */
+struct pannel_image {
+    uint16_t width;
+    uint16_t height;
+    const uint8_t *data;
+};
+
 struct pannel_t *pannel_create(const struct device *render_dev);
 void pannel_render_line(struct pannel_t *pannel, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color);
 void pannel_render_txt(struct pannel_t *pannel, uint8_t *txt, uint16_t x, uint16_t y, uint16_t color);
+void pannel_render_txt_bg(struct pannel_t *pannel, uint8_t *txt, uint16_t x, uint16_t y, uint16_t color, uint16_t bg);
 void pannel_render_rect(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color, bool fill);
 void pannel_render_circle(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t redius, uint16_t color);
+void pannel_render_circle_fill(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t radius, uint16_t color);
+void pannel_render_round_rect(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t radius, uint16_t color, bool fill);
 void pannel_render_clear(struct pannel_t *pannel, uint32_t color);
 void pannel_render_buffer(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *buf);
+void pannel_render_image(struct pannel_t *pannel, uint16_t x, uint16_t y, const struct pannel_image *image);
+void pannel_flush(struct pannel_t *pannel);
+void pannel_frame_end(struct pannel_t *pannel);
+void pannel_clip_set(struct pannel_t *pannel, const struct pannel_rect *rect);
+bool pannel_clip_test(struct pannel_t *pannel, int x, int y, int w, int h);
+void pannel_rect_list_add(struct pannel_rect *list, uint8_t *count, uint8_t max, const struct pannel_rect *rect);
 int pannel_get_capabilities(struct pannel_t *pannel, struct display_capabilities **caps);
\ No newline at end of file
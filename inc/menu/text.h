@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Append-only text builder over a caller supplied buffer. The buffer stays
+ * NUL terminated and output past its end is dropped, so a line can be built
+ * piece by piece without strlen/strncat rescans or printf formatting.
+ */
+struct text_buf {
+    char *buf;
+    size_t size;
+    size_t len;
+};
+
+void text_init(struct text_buf *text, char *buf, size_t size);
+void text_append(struct text_buf *text, const char *str);
+void text_append_char(struct text_buf *text, char c);
+void text_append_int(struct text_buf *text, int32_t value);
+void text_append_fixed(struct text_buf *text, int32_t value, uint8_t scale, uint8_t frac);
+size_t text_int(char *buf, size_t size, int32_t value);
@@ -3,6 +3,8 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/adc.h>
 
+#include <motor/ring.h>
+
 struct adc_t;
 
 typedef void (*adc_callback_func)(uint16_t *values, size_t count, uint8_t id, void *param);
@@ -20,6 +22,48 @@ struct adc_callback_t {
     struct adc_callback_t *next;
 };
 
+enum adc_scan_event {
+    ADC_SCAN_HALF_COMPLETE,
+    ADC_SCAN_FULL_COMPLETE,
+};
+
+/*
+ * Called from the ADC interrupt each time one half of the ping/pong buffer
+ * is filled. samples holds nb_scans scans of ADC_CHANNEL_COUNT values,
+ * indexed by enum channel_id.
+ */
+struct adc_scan_callback_t {
+    void (*func)(struct adc_scan_callback_t *self, const uint16_t *samples, size_t nb_scans, enum adc_scan_event event);
+    void *param;
+    struct adc_scan_callback_t *next;
+};
+
+struct adc_current_samples {
+    uint16_t curr_a;
+    uint16_t curr_c;
+    uint16_t aux;       /* channel picked with adc_current_aux_select() */
+};
+
+/*
+ * Phase current path, called from interrupt context once per PWM period
+ * with CURR_A/CURR_C sampled at the carrier center.
+ */
+struct adc_current_callback_t {
+    void (*func)(struct adc_current_callback_t *self, const struct adc_current_samples *samples, void *param);
+    void *param;
+};
+
+/*
+ * Per-channel sample stream filled from the ADC interrupt. Each consumer
+ * owns one and drains the ring at its own pace.
+ */
+struct adc_stream_t {
+    struct ring_t ring;
+    const char *name;
+    uint8_t id;
+    struct adc_stream_t *next;
+};
+
 struct adc_info {
     const struct adc_channel_info *channels;
     const struct device *dev;
@@ -34,8 +78,13 @@ enum channel_id {
     CURR_A,
     CURR_C,
     SPEED_VALUE,
+    ADC_CHANNEL_COUNT,
 };
 
 struct adc_t *adc_init(const struct adc_info *info);
 int adc_register_callback(struct adc_t *adc, struct adc_callback_t *cb);
+int adc_register_scan_callback(struct adc_t *adc, struct adc_scan_callback_t *cb);
+int adc_register_stream(struct adc_t *adc, struct adc_stream_t *stream);
+int adc_register_current_callback(struct adc_t *adc, struct adc_current_callback_t *cb);
+int adc_current_aux_select(struct adc_t *adc, uint8_t id);
 void adc_start(struct adc_t *adc);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Electrical angle helpers. Angles are a full turn over 16 bits,
+ * results are Q15.
+ */
+
+void angle_init(void);
+void fast_sincos(uint16_t angle, int16_t *sin, int16_t *cos);
+void angle_sincos_table(uint16_t angle, int16_t *sin, int16_t *cos);
+#ifdef CONFIG_MC_SINCOS_CORDIC
+void angle_sincos_cordic(uint16_t angle, int16_t *sin, int16_t *cos);
+#endif
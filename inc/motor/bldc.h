@@ -0,0 +1,58 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/counter.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Six-step trapezoidal drive with sensorless commutation. The floating
+ * phase back-EMF is compared to half the bus voltage once per PWM period,
+ * sampled by the injected sequence in the middle of the high side pulse,
+ * and the next step is fired 30 degrees after the zero crossing by a
+ * counter alarm. Everything past bldc_start() runs in interrupt context.
+ */
+
+struct svpwm_t;
+struct mc_t;
+struct mc_adc_info;
+
+enum bldc_mode {
+    BLDC_MODE_OFF,
+    BLDC_MODE_ALIGN,
+    BLDC_MODE_RAMP,
+    BLDC_MODE_CLOSED_LOOP,
+};
+
+struct bldc_t {
+    const struct device *timer;
+    struct counter_alarm_cfg alarm;
+    struct svpwm_t *svpwm;
+    struct mc_t *mc;
+    const struct mc_adc_info *adc;
+    struct k_event *event;
+    struct k_spinlock lock;
+    uint32_t timer_freq;
+    uint8_t mode;
+    uint8_t step;
+    uint16_t duty;              /* Q15 */
+    uint32_t pulse_min;         /* shortest high side pulse, timer cycles */
+    uint16_t threshold;         /* half bus voltage, in raw back-EMF counts */
+    uint8_t zc_filter;
+    bool zc_seen;
+    uint16_t sync_count;
+    uint32_t commutated_at;
+    uint32_t last_zc;
+    uint32_t step_ticks;        /* filtered 60 degree interval */
+    uint32_t ramp_ticks;
+    uint32_t ramp_elapsed;
+};
+
+int bldc_init(struct bldc_t *bldc, const struct device *timer, struct svpwm_t *svpwm,
+              struct mc_t *mc, const struct mc_adc_info *adc, struct k_event *event);
+int bldc_start(struct bldc_t *bldc, uint16_t duty);
+void bldc_ramp_start(struct bldc_t *bldc);
+void bldc_stop(struct bldc_t *bldc);
+void bldc_bemf_update(struct bldc_t *bldc, uint16_t bemf);
+uint32_t bldc_speed_get(struct bldc_t *bldc);
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Fixed-point field oriented control. Currents, voltages, sin/cos and
+ * duty cycles are Q15; voltages are normalized to the bus voltage.
+ */
+
+#define FOC_PI_SHIFT 12
+
+struct foc_pi {
+    int32_t kp;             /* Q(FOC_PI_SHIFT) */
+    int32_t ki;             /* Q(FOC_PI_SHIFT), per control period */
+    int32_t integral;       /* Q(15 + FOC_PI_SHIFT) */
+    int16_t out_min;
+    int16_t out_max;
+};
+
+struct foc_t {
+    struct foc_pi pi_d;
+    struct foc_pi pi_q;
+    int16_t id_ref;
+    int16_t iq_ref;
+    int16_t i_alpha;
+    int16_t i_beta;
+    int16_t i_d;
+    int16_t i_q;
+    int16_t v_d;
+    int16_t v_q;
+    int16_t v_alpha;
+    int16_t v_beta;
+    uint16_t duty[3];
+    uint8_t sector;
+};
+
+void foc_init(struct foc_t *foc, int32_t kp, int32_t ki);
+void foc_reset(struct foc_t *foc);
+int16_t foc_current_q15(uint16_t raw, int32_t offset);
+void foc_clarke(int16_t ia, int16_t ic, int16_t *alpha, int16_t *beta);
+void foc_park(int16_t alpha, int16_t beta, int16_t sin, int16_t cos, int16_t *d, int16_t *q);
+void foc_inv_park(int16_t d, int16_t q, int16_t sin, int16_t cos, int16_t *alpha, int16_t *beta);
+uint8_t foc_svpwm(int16_t alpha, int16_t beta, uint16_t duty[3]);
+int16_t foc_pi_run(struct foc_pi *pi, int16_t err);
+void foc_step(struct foc_t *foc, int16_t ia, int16_t ic, uint16_t angle);
@@ -10,24 +10,63 @@ struct svpwm_info;
 struct adc_info;
 struct menu_t;
 struct adc_callback_t;
+struct adc_stream_t;
 struct mc_t;
+struct device;
+
+#define MC_ADC_GAIN_SHIFT 16
+
+/* value = ((raw - offset) * gain) >> MC_ADC_GAIN_SHIFT */
+struct mc_adc_calib {
+    int32_t offset;
+    int32_t gain;
+};
+
+struct mc_value_sub;
+
+typedef void (*mc_value_notify_t)(struct mc_value_sub *sub, int32_t value);
+
+/*
+ * Listener on a converted channel value. notify runs from the ADC callback
+ * work, or the phase current work for CURR_A/CURR_C, once the value moved
+ * by threshold or more since the last notification, and no sooner than
+ * interval_ms after it. The first value is always delivered.
+ */
+struct mc_value_sub {
+    uint8_t channel;
+    int32_t threshold;
+    uint32_t interval_ms;
+    mc_value_notify_t notify;
+    void *user_data;
+    bool published;
+    int32_t last_value;
+    uint32_t last_ms;
+    struct mc_value_sub *next;
+};
 
 struct mc_adc_info {
     uint16_t raw_value;
-    double value;
+    int32_t value;      /* mV for voltages, mA for currents */
+    struct mc_adc_calib calib;
     struct adc_callback_t cb;
+    struct mc_value_sub *subs;
 };
 
 struct mc_t *mc_init(uint8_t type, int nb_motor);
 int mc_svpwm_init(struct mc_t *mc, const struct svpwm_info *info, int motor_id);
+int mc_bldc_init(struct mc_t *mc, const struct device *timer, int motor_id);
 int mc_adc_init(struct mc_t *mc, const struct adc_info *info);
 void mc_setup_menu_bind(struct mc_t *mc, struct menu_t *menu);
 int mc_adc_event_register(struct mc_t *mc, struct adc_callback_t *cb);
+int mc_adc_stream_register(struct mc_t *mc, struct adc_stream_t *stream);
 void mc_adc_start(struct mc_t *mc);
 struct motor_t *mc_motor_get(struct mc_t *mc, uint8_t id);
 int mc_motor_count(struct mc_t *mc);
 bool mc_motor_ready(struct mc_t *mc, bool is_ready);
 void mc_motor_voltage_range_set(struct mc_t *mc, int min, int max);
-double mc_vbus_get(struct mc_t *mc);
+int32_t mc_vbus_get(struct mc_t *mc);
+int mc_value_subscribe(struct mc_t *mc, struct mc_value_sub *sub);
+void mc_current_calibrate(struct mc_t *mc);
+int mc_current_aux_select(struct mc_t *mc, uint8_t id);
 void mc_menu_bind(struct menu_t *menu, struct mc_t *mc);
 
@@ -7,6 +7,8 @@ struct svpwm_info;
 struct menu_item_t;
 struct mc_t;
 struct mc_adc_info;
+struct adc_current_samples;
+struct device;
 
 enum motor_type {
     MOTOR_TYPE_BLDC,
@@ -15,13 +17,18 @@ enum motor_type {
 
 enum motor_event_t {
     MOTOR_EVENT_READY = 1,
-    MOTOR_EVENT_IDLE,
+    MOTOR_EVENT_IDLE = 2,
+    MOTOR_EVENT_SYNC = 4,
+    MOTOR_EVENT_STALL = 8,
 };
 
 struct motor_t *motor_init(struct mc_t *mc, struct mc_adc_info *, uint8_t type, uint8_t id);
 int motor_svpwm_init(struct motor_t *motor, const struct svpwm_info *info);
+int motor_bldc_init(struct motor_t *motor, const struct device *timer);
 void motor_type_change_cb(struct menu_item_t *item, uint8_t type);
 void motor_svpwm_freq_set_range(struct motor_t *motor, uint16_t min, uint16_t max);
 void motor_svpwm_freq_set_cb(struct menu_item_t *item, int32_t min, int32_t max);
 void motor_ready(struct motor_t *motor);
-void motor_idle(struct motor_t *motor);
\ No newline at end of file
+void motor_idle(struct motor_t *motor);
+void motor_current_update(struct motor_t *motor, const struct adc_current_samples *samples);
+uint32_t motor_speed_get(struct motor_t *motor);
\ No newline at end of file
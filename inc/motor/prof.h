@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Control path probes. A probe records a cycle count, either the cost of a
+ * section (PROF_START/PROF_STOP) or the latency between a stamp taken in
+ * one context and the moment another one picks it up.
+ */
+
+enum prof_probe {
+    PROF_ADC_SCAN,          /* scan interrupt */
+    PROF_ADC_DISPATCH,      /* half buffer ready -> dispatch work running */
+    PROF_ADC_CALLBACK,      /* mc_adc_callback_entry */
+    PROF_CURRENT_ISR,       /* injected conversion interrupt */
+    PROF_CONTROL_LOOP,      /* motor_current_update */
+    PROF_FOC_STEP,          /* foc_step */
+    PROF_PWM_UPDATE,        /* motor_pwm_apply, all three phases */
+    PROF_MOTOR_WAKE,        /* event posted -> motor thread running */
+    PROF_COUNT,
+};
+
+#define PROF_HIST_BINS 20
+
+#ifdef CONFIG_MC_PROFILING
+
+uint32_t prof_now(void);
+void prof_record(enum prof_probe probe, uint32_t cycles);
+void prof_reset(void);
+
+#define PROF_START(stamp)           uint32_t stamp = prof_now()
+#define PROF_STOP(probe, stamp)     prof_record(probe, prof_now() - (stamp))
+
+#else
+
+static inline uint32_t prof_now(void)
+{
+    return 0;
+}
+
+static inline void prof_record(enum prof_probe probe, uint32_t cycles)
+{
+}
+
+static inline void prof_reset(void)
+{
+}
+
+#define PROF_START(stamp)
+#define PROF_STOP(probe, stamp)
+
+#endif
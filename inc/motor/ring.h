@@ -0,0 +1,27 @@
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Lock-free single-producer/single-consumer ring of 16-bit samples. head is
+ * only written by the producer and tail only by the consumer, both run
+ * freely and wrap; size must be a power of two. A full ring drops the new
+ * sample and counts an overrun, the producer never waits.
+ */
+struct ring_t {
+    uint16_t *buf;
+    uint32_t mask;
+    atomic_t head;
+    atomic_t tail;
+    atomic_t overrun;
+};
+
+int ring_init(struct ring_t *ring, uint16_t *buf, uint32_t size);
+bool ring_put(struct ring_t *ring, uint16_t value);
+size_t ring_get(struct ring_t *ring, uint16_t *out, size_t max);
+size_t ring_count(struct ring_t *ring);
+uint32_t ring_overrun_get(struct ring_t *ring);
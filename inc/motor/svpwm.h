@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <zephyr/drivers/gpio.h>
 
 struct svpwm_t;
@@ -20,4 +21,8 @@ struct svpwm_t *svpwm_init(const struct svpwm_info *info);
 void svpwm_freq_set_range(struct svpwm_t *pwm, uint16_t min, uint16_t max);
 int svpwm_freq_set(struct svpwm_t *pwm, uint16_t freq);
 int svpwm_update_pulse(struct svpwm_t *pwm, uint8_t channel, uint16_t pulse);
-int svpwm_update_freq_and_pulse(struct svpwm_t *pwm, uint8_t channel, uint16_t freq, uint16_t pulse);
\ No newline at end of file
+int svpwm_update_freq_and_pulse(struct svpwm_t *pwm, uint8_t channel, uint16_t freq, uint16_t pulse);
+uint32_t svpwm_period_get(struct svpwm_t *pwm);
+uint32_t svpwm_freq_get(struct svpwm_t *pwm);
+void svpwm_channel_enable(struct svpwm_t *pwm, uint8_t channel, bool enable);
+void svpwm_enable(struct svpwm_t *pwm, bool enable);
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+struct device;
+
+struct display_sim_cost {
+    uint32_t writes;
+    uint32_t bytes;
+    uint32_t pixels;
+};
+
+/*
+ * A frame is everything written between two display_sim_frame_end() calls,
+ * the panel marks one per menu repaint.
+ */
+struct display_sim_stats {
+    uint32_t frames;
+    struct display_sim_cost total;
+    struct display_sim_cost last;
+    struct display_sim_cost max;
+    uint32_t crc;               /* of the whole framebuffer after the last frame */
+};
+
+void display_sim_frame_end(const struct device *dev);
+void display_sim_stats_get(const struct device *dev, struct display_sim_stats *stats);
+void display_sim_stats_reset(const struct device *dev);
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+struct device;
+
+/* turn the knob, one trigger per detent */
+int qdec_sim_rotate(const struct device *dev, int32_t detents);
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Converts a PNG into a run-length coded RGB565 struct pannel_image source.
+
+Packets run over the rows: a header byte holds the pixel count minus one in
+the low 7 bits. With the top bit set one pixel follows and is repeated,
+otherwise count pixels follow. Pixels are little endian RGB565, transparent
+ones are blended onto --background.
+
+Only non-interlaced 8-bit PNGs are read, no imaging library is needed.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+MAX_COUNT = 128
+
+
+def png_chunks(data):
+    pos = len(PNG_SIGNATURE)
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        yield kind, data[pos + 8:pos + 8 + length]
+        pos += length + 12
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def unfilter(raw, width, height, bpp):
+    stride = width * bpp
+    rows = []
+    prev = bytearray(stride)
+    pos = 0
+    for _ in range(height):
+        kind = raw[pos]
+        line = bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += stride + 1
+        for i in range(stride):
+            left = line[i - bpp] if i >= bpp else 0
+            up = prev[i]
+            corner = prev[i - bpp] if i >= bpp else 0
+            if kind == 1:
+                line[i] = (line[i] + left) & 0xff
+            elif kind == 2:
+                line[i] = (line[i] + up) & 0xff
+            elif kind == 3:
+                line[i] = (line[i] + (left + up) // 2) & 0xff
+            elif kind == 4:
+                line[i] = (line[i] + paeth(left, up, corner)) & 0xff
+        rows.append(line)
+        prev = line
+    return rows
+
+
+def read_png(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if not data.startswith(PNG_SIGNATURE):
+        sys.exit(f'{path}: not a PNG')
+
+    idat = b''
+    palette = alpha = None
+    for kind, body in png_chunks(data):
+        if kind == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', body)
+        elif kind == b'PLTE':
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif kind == b'tRNS':
+            alpha = body
+        elif kind == b'IDAT':
+            idat += body
+
+    if depth != 8 or interlace or color not in CHANNELS:
+        sys.exit(f'{path}: only non-interlaced 8-bit PNGs are supported')
+
+    bpp = CHANNELS[color]
+    pixels = []
+    for line in unfilter(zlib.decompress(idat), width, height, bpp):
+        for i in range(0, len(line), bpp):
+            px = line[i:i + bpp]
+            if color == 0:
+                pixels.append((px[0], px[0], px[0], 255))
+            elif color == 2:
+                pixels.append((px[0], px[1], px[2], 255))
+            elif color == 3:
+                a = alpha[px[0]] if alpha and px[0] < len(alpha) else 255
+                pixels.append(palette[px[0]] + (a,))
+            elif color == 4:
+                pixels.append((px[0], px[0], px[0], px[1]))
+            else:
+                pixels.append(tuple(px))
+    return width, height, pixels
+
+
+def rgb565(pixel, background):
+    r, g, b, a = pixel
+    br, bg, bb = background
+    r = (r * a + br * (255 - a)) // 255
+    g = (g * a + bg * (255 - a)) // 255
+    b = (b * a + bb * (255 - a)) // 255
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def encode(pixels):
+    out = bytearray()
+    literal = []
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:MAX_COUNT]
+            del literal[:MAX_COUNT]
+            out.append(len(chunk) - 1)
+            for p in chunk:
+                out.extend(struct.pack('<H', p))
+
+    i = 0
+    while i < len(pixels):
+        n = 1
+        while i + n < len(pixels) and n < MAX_COUNT and pixels[i + n] == pixels[i]:
+            n += 1
+        # a run of two costs as much as two literals, keep it in the literal
+        if n > 2:
+            flush_literal()
+            out.append(0x80 | (n - 1))
+            out.extend(struct.pack('<H', pixels[i]))
+        else:
+            literal.extend(pixels[i:i + n])
+        i += n
+    flush_literal()
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument('png')
+    parser.add_argument('-n', '--name', required=True, help='C symbol of the image')
+    parser.add_argument('-o', '--output', required=True)
+    parser.add_argument('--background', default='000000',
+                        help='RRGGBB the alpha channel is blended onto')
+    args = parser.parse_args()
+
+    background = tuple(bytes.fromhex(args.background))
+    width, height, pixels = read_png(args.png)
+    data = encode([rgb565(p, background) for p in pixels])
+
+    with open(args.output, 'w') as f:
+        f.write(f'/* generated by img2rle.py from {args.png.split("/")[-1]}, '
+                f'{len(data)} of {width * height * 2} bytes */\n\n')
+        f.write('#include <pannel.h>\n\n')
+        f.write(f'static const uint8_t {args.name}_data[] = {{\n')
+        for i in range(0, len(data), 12):
+            f.write('    ' + ', '.join(f'0x{b:02x}' for b in data[i:i + 12]) + ',\n')
+        f.write('};\n\n')
+        f.write(f'const struct pannel_image {args.name} = {{\n')
+        f.write(f'    .width = {width},\n')
+        f.write(f'    .height = {height},\n')
+        f.write(f'    .data = {args.name}_data,\n')
+        f.write('};\n')
+
+
+if __name__ == '__main__':
+    main()
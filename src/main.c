@@ -115,6 +115,11 @@ int main(void)
     }
 
     mc = mc_init(MOTOR_TYPE_BLDC, 1);
+    if (!mc)
+    {
+        LOG_ERR("mc init err");
+        return -1;
+    }
 
     mc_menu_bind(menu, mc);
 
@@ -123,6 +128,13 @@ int main(void)
         return -1;
     }
 
+#if DT_NODE_EXISTS(DT_ALIAS(commutation_timer))
+    if (mc_bldc_init(mc, DEVICE_DT_GET(DT_ALIAS(commutation_timer)), 0))
+    {
+        LOG_WRN("six-step commutation unavailable");
+    }
+#endif
+
     if (mc_adc_init(mc, &adc_info))
     {
         return -1;
@@ -132,6 +144,8 @@ int main(void)
 
     mc_setup_menu_bind(mc, menu);
 
+    menu_status_bind(mc);
+
     mc_adc_start(mc);
 
     menu_render_start(menu);
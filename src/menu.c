@@ -1,6 +1,5 @@
 #include <menu/menu.h>
-
-#include <stdio.h>
+#include <menu/text.h>
 
 struct device;
 
@@ -11,6 +10,11 @@ LOG_MODULE_DECLARE(menu, CONFIG_LOG_DEFAULT_LEVEL);
 
 extern void motor_ctrl(void *ctrl, bool enable);
 extern void menu_driver_start(struct menu_t *menu, void (*start)(void *, bool), bool en);
+
+/* images/start.png and images/stop.png, converted by rle_image() */
+extern const struct pannel_image image_start;
+extern const struct pannel_image image_stop;
+
 static int menu_item_label_vbus_cb(struct menu_item_t *item, char *buf, size_t len);
 static bool startup_checkbox_cb(struct menu_item_t *item, bool is_on);
 // static void startup_confirm_cb(struct menu_item_t *item, bool confirmed);
@@ -44,16 +48,73 @@ static struct menu_item_t voltage_item = {
     .visible = true,
 };
 
+#define STATUS_PLOT_WIDTH 90
+#define STATUS_PLOT_HEIGHT 14
+
+static int32_t vbus_samples[STATUS_PLOT_WIDTH];
+static int32_t curr_samples[STATUS_PLOT_WIDTH];
+static int32_t speed_samples[STATUS_PLOT_WIDTH];
+
+/* the motor's allowed supply range, a sample every 250 ms */
+static struct menu_item_t vbus_plot_item = {
+    .name = "vbus",
+    .id = 11,
+    .style = MENU_STYLE_NORMAL,
+    .type = MENU_ITEM_TYPE_PLOT,
+    .plot = {
+        .samples = vbus_samples,
+        .width = STATUS_PLOT_WIDTH,
+        .height = STATUS_PLOT_HEIGHT,
+        .min = 6000,
+        .max = 24000,
+    },
+    .visible = true,
+};
+
+/* phase A current in mA, a sample every 50 ms */
+static struct menu_item_t curr_plot_item = {
+    .name = "ia",
+    .id = 12,
+    .style = MENU_STYLE_NORMAL | MENU_SET_COLOR(COLOR_YELLOW),
+    .type = MENU_ITEM_TYPE_PLOT,
+    .plot = {
+        .samples = curr_samples,
+        .width = STATUS_PLOT_WIDTH,
+        .height = STATUS_PLOT_HEIGHT,
+        .min = -10000,
+        .max = 10000,
+    },
+    .visible = true,
+};
+
+/* speed setpoint over the raw ADC range, a sample every 250 ms */
+static struct menu_item_t speed_plot_item = {
+    .name = "speed",
+    .id = 13,
+    .style = MENU_STYLE_NORMAL | MENU_SET_COLOR(COLOR_CYAN),
+    .type = MENU_ITEM_TYPE_PLOT,
+    .plot = {
+        .samples = speed_samples,
+        .width = STATUS_PLOT_WIDTH,
+        .height = STATUS_PLOT_HEIGHT,
+        .min = 0,
+        .max = 4095,
+    },
+    .visible = true,
+};
+
 static struct menu_item_t startup_item = {
     .name = "Start",
     .id = 2,
-    .style = MENU_STYLE_NORMAL | MENU_STYLE_VALUE_ONLY,
+    .style = MENU_STYLE_NORMAL | MENU_STYLE_VALUE_ONLY | MENU_STYLE_CHECKBOX_IMG,
     .type = MENU_ITEM_TYPE_CHECKBOX,
     .checkbox = {
         .is_on = false,
         .cb = startup_checkbox_cb,
         .text_on = "Stop",
         .text_off = "Start",
+        .img_on = &image_stop,
+        .img_off = &image_start,
     },
     .visible = true,
 };
@@ -87,11 +148,65 @@ static bool startup_checkbox_cb(struct menu_item_t *item, bool is_on)
     }
 }
 
+static void menu_value_notify(struct mc_value_sub *sub, int32_t value)
+{
+    menu_item_queue_update(sub->user_data, value);
+}
+
+/* the label shows 10 mV steps */
+static struct mc_value_sub vbus_sub = {
+    .channel = VOLTAGE_BUS,
+    .threshold = 10,
+    .interval_ms = 100,
+    .notify = menu_value_notify,
+    .user_data = &voltage_item,
+};
+
+static struct mc_value_sub vbus_plot_sub = {
+    .channel = VOLTAGE_BUS,
+    .interval_ms = 250,
+    .notify = menu_value_notify,
+    .user_data = &vbus_plot_item,
+};
+
+static struct mc_value_sub curr_plot_sub = {
+    .channel = CURR_A,
+    .interval_ms = 50,
+    .notify = menu_value_notify,
+    .user_data = &curr_plot_item,
+};
+
+static struct mc_value_sub speed_plot_sub = {
+    .channel = SPEED_VALUE,
+    .interval_ms = 250,
+    .notify = menu_value_notify,
+    .user_data = &speed_plot_item,
+};
+
 static int menu_item_label_vbus_cb(struct menu_item_t *item, char *buf, size_t len)
 {
-    double voltage = mc_vbus_get(menu_driver_get(item->menu));
+    int32_t mv = mc_vbus_get(menu_driver_get(item->menu));
+
+    struct text_buf text;
+
+    text_init(&text, buf, len);
+    text_append_fixed(&text, mv, 3, 2);
+    text_append_char(&text, 'V');
+    return 0;
+}
+
+static int menu_group_add_items(struct menu_group_t *group, struct menu_item_t *const *items, size_t count)
+{
+    int ret;
+
+    for (size_t i = 0; i < count; i++) {
+        ret = menu_group_add_item(group, items[i]);
+        if (ret) {
+            LOG_ERR("add item %s (id %d) err:%d", items[i]->name, items[i]->id, ret);
+            return ret;
+        }
+    }
 
-    snprintf(buf, len, "%.2fV", voltage);
     return 0;
 }
 
@@ -102,6 +217,10 @@ int menu_init(const struct device *dev, struct menu_t **out)
     struct menu_group_t *main_group;
     struct menu_group_t *setup_group;
     extern struct menu_item_t setup_motor_item;
+    struct menu_item_t *status_items[] = { &voltage_item, &vbus_plot_item, &curr_plot_item, &speed_plot_item };
+    struct menu_item_t *main_items[] = { &setup_item, &startup_item };
+    struct menu_item_t *setup_items[] = { &setup_motor_item, &setup_display_item, &setup_power_item };
+    int ret;
 
     menu = menu_create(dev);
 
@@ -111,19 +230,29 @@ int menu_init(const struct device *dev, struct menu_t **out)
     }
 
     status_group = menu_group_create(menu, "Status", 60, 5, 100, 75, COLOR_BLUE, MENU_LAYOUT_VERTICAL | MENU_ALIGN_V_CENTER, MENU_STYLE_LEFT);
-    
-    menu_group_add_item(status_group, &voltage_item);
+
+    ret = menu_group_add_items(status_group, status_items, ARRAY_SIZE(status_items));
+    if (ret)
+    {
+        return ret;
+    }
 
     main_group = menu_group_create(menu, "main", 0, 5, 55, 75, COLOR_WHITE, MENU_LAYOUT_VERTICAL | MENU_ALIGN_V_CENTER, MENU_STYLE_CENTER);
 
-    menu_group_add_item(main_group, &setup_item);
-    menu_group_add_item(main_group, &startup_item);
+    ret = menu_group_add_items(main_group, main_items, ARRAY_SIZE(main_items));
+    if (ret)
+    {
+        return ret;
+    }
 
     setup_group = menu_group_create(menu, "Setup", 40, 5, 100, 75, COLOR_MAGENTA, MENU_LAYOUT_VERTICAL | MENU_ALIGN_V_CENTER, MENU_STYLE_CENTER);
 
-    menu_group_add_item(setup_group, &setup_motor_item);
-    menu_group_add_item(setup_group, &setup_display_item);
-    menu_group_add_item(setup_group, &setup_power_item);
+    ret = menu_group_add_items(setup_group, setup_items, ARRAY_SIZE(setup_items));
+    if (ret)
+    {
+        return ret;
+    }
+
     menu_group_bind_item(setup_group, &setup_item);
 
     menu_set_main_group(menu, main_group);
@@ -132,4 +261,18 @@ int menu_init(const struct device *dev, struct menu_t **out)
         *out = menu;
 
     return 0;
-}
\ No newline at end of file
+}
+
+int menu_status_bind(struct mc_t *mc)
+{
+    struct mc_value_sub *subs[] = { &vbus_sub, &vbus_plot_sub, &curr_plot_sub, &speed_plot_sub };
+    int ret;
+
+    for (int i = 0; i < ARRAY_SIZE(subs); i++) {
+        ret = mc_value_subscribe(mc, subs[i]);
+        if (ret)
+            return ret;
+    }
+
+    return 0;
+}
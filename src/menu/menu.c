@@ -9,12 +9,41 @@
 
 #include <menu/menu.h>
 #include <menu/pannel.h>
+#include <menu/text.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <math.h>
 
 LOG_MODULE_REGISTER(menu, CONFIG_LOG_DEFAULT_LEVEL);
 
 #define MENU_STACK_SIZE 4096
 #define MENU_GROUP_STACK_SIZE 8
+#define MENU_GROUP_CORNER_RADIUS 4
+#define MENU_DAMAGE_MAX 8
+#define MENU_KEY_QUEUE_SIZE 8
+#define MENU_QDEC_MAX_STEPS 16
+/* needle positions over the 270 degree sweep of a gauge */
+#define MENU_GAUGE_STEPS 54
+
+/*
+ * What a frame needs from the state other threads may change, copied under
+ * state_mutex so drawing runs without it. Item values and visibility are
+ * only written from the menu thread and are read in place.
+ */
+struct menu_view {
+    struct menu_item_t *current_item;
+    struct menu_item_t *editing_item;
+    int group_stack_top;
+    bool dialog;
+    uint8_t dialog_selected_button;
+    struct item_dialog_t dialog_item;
+};
+
+/* a key event and the encoder steps that came before it */
+struct menu_key_slot {
+    menu_input_event_t event;
+    int32_t qdec_steps;
+};
 
 struct menu_t {
     struct menu_item_t *item;
@@ -33,10 +62,29 @@ struct menu_t {
     struct menu_item_t *current_item;
     struct menu_item_t *selected_item;
     struct menu_item_t *editing_item;
+    struct menu_view view;
     struct k_sem render_sem;
     struct k_mutex pannel_mutex;
+    int pannel_depth;
+    struct pannel_rect damage[MENU_DAMAGE_MAX];
+    uint8_t damage_count;
+    /* indexed by item id, filled by menu_item_add() and menu_group_bind_item() */
+    struct menu_item_t *item_by_id[256];
+    struct menu_item_t *item_tail;
+    struct menu_group_t *group_by_item[256];
     struct k_mutex state_mutex;
     struct k_msgq update_msgq;
+
+    /*
+     * Input producers never take a lock: encoder steps add up in qdec_steps
+     * and keys go through a single-producer ring, both drained by the menu
+     * thread once input_signal is raised.
+     */
+    struct k_poll_signal input_signal;
+    atomic_t qdec_steps;
+    struct menu_key_slot key_queue[MENU_KEY_QUEUE_SIZE];
+    atomic_t key_head;
+    atomic_t key_tail;
     
     const struct device *qdec_dev;
     const struct device *adc2_dev;
@@ -51,28 +99,25 @@ struct menu_t {
     struct sensor_trigger trigger;
     bool disable_qdec;
     void *driver;
-    struct k_timer label_refresh_timer;
-    struct k_work label_refresh_work;
    struct menu_item_t dialog_item_storage;
    struct menu_item_t *dialog_item;
    uint8_t dialog_selected_button;
 };
 
-static void menu_render_dialog(struct menu_t *menu, struct menu_item_t *item);
+static void menu_render_dialog(struct menu_t *menu, const struct item_dialog_t *dialog);
 static void menu_process_dialog_input(struct menu_t *menu, menu_input_event_t *event);
-static void label_refresh_work_handler(struct k_work *work);
-static struct menu_item_t *find_menu_item_by_id(struct menu_item_t *root, uint8_t id);
 static void menu_get_item_layout(struct menu_group_t *group, struct menu_item_t *item_to_find, uint16_t *out_x, uint16_t *out_y, uint16_t *out_w);
-static void menu_refresh_item_selection(struct menu_t *menu, struct menu_item_t *last_item, struct menu_item_t *current_item);
-static void menu_refresh_single_item(struct menu_t *menu, struct menu_item_t *item);
 static void menu_refresh_single_item_fast(struct menu_item_t *item, bool selected);
 static void menu_render_item_value_only(struct menu_item_t *item);
 static void menu_update_group_visibility(struct menu_t *menu);
 static void _menu_update_group_visibility_nolock(struct menu_t *menu);
 static struct menu_group_t *find_group_by_bind_item(struct menu_t *menu, struct menu_item_t *item);
-static void render_truncated_text(struct pannel_t *pannel, const char *text, uint16_t x, uint16_t y, uint16_t color, uint16_t max_width);
+static void render_truncated_text(struct pannel_t *pannel, const char *text, uint16_t x, uint16_t y, uint16_t color, uint16_t bg, uint16_t max_width);
 static void menu_render_list_item_at_index(struct menu_t *menu, struct menu_item_t *item, uint8_t index, bool selected);
 static void menu_render_input_min_max_editing(struct menu_t *menu, struct menu_item_t *item);
+static void menu_render_plot(struct menu_t *menu, struct menu_item_t *item, uint16_t x, uint16_t y);
+static void menu_render_bar(struct menu_t *menu, struct menu_item_t *item, uint16_t x, uint16_t y, uint16_t width);
+static void menu_render_gauge(struct menu_t *menu, struct menu_item_t *item, uint16_t x, uint16_t y);
 
 
 static void menu_render_group_chrome(struct menu_t *menu, struct menu_group_t *group)
@@ -81,7 +126,12 @@ static void menu_render_group_chrome(struct menu_t *menu, struct menu_group_t *g
         return;
     }
 
-    pannel_render_rect(menu->pannel, group->x, group->y, group->width, group->height, group->color, false);
+    if (group->style & MENU_STYLE_ROUND_CORNER) {
+        pannel_render_round_rect(menu->pannel, group->x, group->y, group->width, group->height,
+                                 MENU_GROUP_CORNER_RADIUS, group->color, false);
+    } else {
+        pannel_render_rect(menu->pannel, group->x, group->y, group->width, group->height, group->color, false);
+    }
 
     if (group->title[0] != '\0') {
         size_t title_len = strlen((const char *)group->title);
@@ -90,11 +140,11 @@ static void menu_render_group_chrome(struct menu_t *menu, struct menu_group_t *g
         uint16_t gap_x = title_x - 2;
         uint16_t gap_width = title_width + 4;
         pannel_render_rect(menu->pannel, gap_x, group->y, gap_width, 1, COLOR_BLACK, true);
-        pannel_render_txt(menu->pannel, group->title, title_x, group->y - (CONFIG_FONT_HEIGHT / 2), COLOR_WHITE);
+        pannel_render_txt_bg(menu->pannel, group->title, title_x, group->y - (CONFIG_FONT_HEIGHT / 2), COLOR_WHITE, COLOR_BLACK);
     }
 }
 
-static void render_truncated_text(struct pannel_t *pannel, const char *text, uint16_t x, uint16_t y, uint16_t color, uint16_t max_width)
+static void render_truncated_text(struct pannel_t *pannel, const char *text, uint16_t x, uint16_t y, uint16_t color, uint16_t bg, uint16_t max_width)
 {
     if (max_width < CONFIG_FONT_WIDTH) {
         return;
@@ -104,14 +154,14 @@ static void render_truncated_text(struct pannel_t *pannel, const char *text, uin
     uint16_t text_width = text_len * CONFIG_FONT_WIDTH;
 
     if (text_width <= max_width) {
-        pannel_render_txt(pannel, (uint8_t *)text, x, y, color);
+        pannel_render_txt_bg(pannel, (uint8_t *)text, x, y, color, bg);
     } else {
         size_t max_chars = max_width / CONFIG_FONT_WIDTH;
         char truncated_text[33];
         if (max_chars > 32) max_chars = 32;
         strncpy(truncated_text, text, max_chars);
         truncated_text[max_chars] = '\0';
-        pannel_render_txt(pannel, (uint8_t *)truncated_text, x, y, color);
+        pannel_render_txt_bg(pannel, (uint8_t *)truncated_text, x, y, color, bg);
     }
 }
 
@@ -122,6 +172,21 @@ static void menu_render_item(struct menu_t *menu, struct menu_item_t *item,
         return;
     }
 
+    if (item->type == MENU_ITEM_TYPE_PLOT) {
+        menu_render_plot(menu, item, x, y);
+        return;
+    }
+
+    if (item->type == MENU_ITEM_TYPE_BAR) {
+        menu_render_bar(menu, item, x, y, render_width);
+        return;
+    }
+
+    if (item->type == MENU_ITEM_TYPE_GAUGE) {
+        menu_render_gauge(menu, item, x, y);
+        return;
+    }
+
     uint16_t text_color = COLOR_WHITE;
     uint16_t bg_color = COLOR_BLACK;
     size_t name_len = 0;
@@ -146,11 +211,11 @@ static void menu_render_item(struct menu_t *menu, struct menu_item_t *item,
     char value_buf[16] = {0};
 
     if (item->type == MENU_ITEM_TYPE_INPUT) {
-        int32_t value_to_display = (menu->editing_item == item) ? item->input.editing_value : item->input.value;
+        int32_t value_to_display = (menu->view.editing_item == item) ? item->input.editing_value : item->input.value;
         if (item->input.value_get_str_cb) {
             item->input.value_get_str_cb(item, value_buf, sizeof(value_buf));
         } else {
-            snprintf(value_buf, sizeof(value_buf), "%d", value_to_display);
+            text_int(value_buf, sizeof(value_buf), value_to_display);
         }
         strncpy(item->input.rendered_value_str, value_buf, sizeof(item->input.rendered_value_str) - 1);
         item->input.rendered_value_str[sizeof(item->input.rendered_value_str) - 1] = '\0';
@@ -195,31 +260,34 @@ static void menu_render_item(struct menu_t *menu, struct menu_item_t *item,
         available_width = 9999;
     }
 
-    char full_text[128] = {0};
+    char full_text[128];
     char temp_buf[64] = {0};
+    struct text_buf line;
+
+    text_init(&line, full_text, sizeof(full_text));
 
     if (!(item->style & MENU_STYLE_VALUE_ONLY)) {
-        strncat(full_text, (const char *)item->name, sizeof(full_text) - strlen(full_text) - 1);
+        text_append(&line, (const char *)item->name);
     }
 
     switch(item->type) {
         case MENU_ITEM_TYPE_LABEL:
             if (item->label_cb) {
                 item->label_cb(item, temp_buf, sizeof(temp_buf));
-                strncat(full_text, ":", sizeof(full_text) - strlen(full_text) - 1);
-                strncat(full_text, temp_buf, sizeof(full_text) - strlen(full_text) - 1);
+                text_append_char(&line, ':');
+                text_append(&line, temp_buf);
                 strncpy(item->label.rendered_label_str, temp_buf, sizeof(item->label.rendered_label_str) - 1);
                 item->label.rendered_label_str[sizeof(item->label.rendered_label_str) - 1] = '\0';
             }
             break;
         case MENU_ITEM_TYPE_INPUT:
             if (!item->input.value_get_str_cb || (value_buf[0] != ':' && value_buf[0] != ' ')) {
-                strncat(full_text, ":", sizeof(full_text) - strlen(full_text) - 1);
+                text_append_char(&line, ':');
             }
-            strncat(full_text, value_buf, sizeof(full_text) - strlen(full_text) - 1);
+            text_append(&line, value_buf);
             break;
         case MENU_ITEM_TYPE_SWITCH:
-            bool is_on = (menu->editing_item == item) ? item->switch_ctrl.editing_is_on : item->switch_ctrl.is_on;
+            bool is_on = (menu->view.editing_item == item) ? item->switch_ctrl.editing_is_on : item->switch_ctrl.is_on;
             const char *switch_str;
             if (is_on) {
                 switch_str = item->switch_ctrl.text_on ? item->switch_ctrl.text_on : "ON";
@@ -228,22 +296,22 @@ static void menu_render_item(struct menu_t *menu, struct menu_item_t *item,
             }
 
             if (!(item->style & MENU_STYLE_VALUE_ONLY)) {
-                strncat(full_text, ":", sizeof(full_text) - strlen(full_text) - 1);
+                text_append_char(&line, ':');
             }
-            strncat(full_text, switch_str, sizeof(full_text) - strlen(full_text) - 1);
+            text_append(&line, switch_str);
             strncpy(item->switch_ctrl.rendered_value_str, switch_str, sizeof(item->switch_ctrl.rendered_value_str) - 1);
             item->switch_ctrl.rendered_value_str[sizeof(item->switch_ctrl.rendered_value_str) - 1] = '\0';
             break;
         case MENU_ITEM_TYPE_LIST:
-            if (menu->editing_item == item) {
+            if (menu->view.editing_item == item) {
             // In editing mode, we might just show the name, as the list is rendered separately
             } else {
                 if (item->list.num_options > 0 && item->list.selected_index < item->list.num_options) {
                     const char *selected_option = item->list.options[item->list.selected_index];
                     if (!(item->style & MENU_STYLE_VALUE_ONLY)) {
-                        strncat(full_text, ":", sizeof(full_text) - strlen(full_text) - 1);
+                        text_append_char(&line, ':');
                     }
-                    strncat(full_text, selected_option, sizeof(full_text) - strlen(full_text) - 1);
+                    text_append(&line, selected_option);
                     strncpy(item->list.rendered_value_str, selected_option, sizeof(item->list.rendered_value_str) - 1);
                     item->list.rendered_value_str[sizeof(item->list.rendered_value_str) - 1] = '\0';
                 }
@@ -252,30 +320,31 @@ static void menu_render_item(struct menu_t *menu, struct menu_item_t *item,
         case MENU_ITEM_TYPE_CHECKBOX:
             {
                 if (item->style & MENU_STYLE_CHECKBOX_IMG) {
-                    const uint8_t *img_buf = item->checkbox.is_on ?
-                                                (const uint8_t *)item->checkbox.text_on :
-                                                (const uint8_t *)item->checkbox.text_off;
-                    if (img_buf) {
+                    const struct pannel_image *img = item->checkbox.is_on ?
+                                                item->checkbox.img_on : item->checkbox.img_off;
+                    if (img) {
+                        /* an icon wider than the row stays left aligned */
+                        uint16_t room = render_width > img->width ? render_width - img->width : 0;
                         uint16_t img_x = x;
                         if (item->style & MENU_STYLE_CENTER) {
-                            img_x = x + (render_width - item->checkbox.img_width) / 2;
+                            img_x = x + room / 2;
                         } else if (item->style & MENU_STYLE_RIGHT) {
-                            img_x = x + render_width - item->checkbox.img_width;
+                            img_x = x + room;
                         }
-                        pannel_render_buffer(menu->pannel, img_x, y, item->checkbox.img_width, item->checkbox.img_height, (uint8_t *)img_buf);
+                        pannel_render_image(menu->pannel, img_x, y, img);
                     }
-                    full_text[0] = '\0'; // Clear text to prevent rendering
+                    text_init(&line, full_text, sizeof(full_text)); // Clear text to prevent rendering
                 } else {
                     const char *checkbox_str = item->checkbox.is_on ?
                                                 (item->checkbox.text_on ? item->checkbox.text_on : "ON") :
                                                 (item->checkbox.text_off ? item->checkbox.text_off : "OFF");
 
                     if (item->style & MENU_STYLE_VALUE_ONLY) {
-                        full_text[0] = '\0';
+                        text_init(&line, full_text, sizeof(full_text));
                     } else {
-                        strncat(full_text, ":", sizeof(full_text) - strlen(full_text) - 1);
+                        text_append_char(&line, ':');
                     }
-                    strncat(full_text, checkbox_str, sizeof(full_text) - strlen(full_text) - 1);
+                    text_append(&line, checkbox_str);
                     strncpy(item->checkbox.rendered_value_str, checkbox_str, sizeof(item->checkbox.rendered_value_str) - 1);
                     item->checkbox.rendered_value_str[sizeof(item->checkbox.rendered_value_str) - 1] = '\0';
                 }
@@ -283,11 +352,15 @@ static void menu_render_item(struct menu_t *menu, struct menu_item_t *item,
             break;
         case MENU_ITEM_TYPE_INPUT_MIN_MAX:
            {
-               snprintf(temp_buf, sizeof(temp_buf), "%d-%d", item->input_min_max.min_value, item->input_min_max.max_value);
+               struct text_buf range;
+               text_init(&range, temp_buf, sizeof(temp_buf));
+               text_append_int(&range, item->input_min_max.min_value);
+               text_append_char(&range, '-');
+               text_append_int(&range, item->input_min_max.max_value);
                if (!(item->style & MENU_STYLE_VALUE_ONLY)) {
-                   strncat(full_text, ":", sizeof(full_text) - strlen(full_text) - 1);
+                   text_append_char(&line, ':');
                }
-               strncat(full_text, temp_buf, sizeof(full_text) - strlen(full_text) - 1);
+               text_append(&line, temp_buf);
                strncpy(item->input_min_max.rendered_value_str, temp_buf, sizeof(item->input_min_max.rendered_value_str) - 1);
                item->input_min_max.rendered_value_str[sizeof(item->input_min_max.rendered_value_str) - 1] = '\0';
                break;
@@ -296,39 +369,184 @@ static void menu_render_item(struct menu_t *menu, struct menu_item_t *item,
                 break;
     }
 
-    render_truncated_text(menu->pannel, full_text, text_x, text_y, text_color, available_width);
+    render_truncated_text(menu->pannel, full_text, text_x, text_y, text_color, bg_color, available_width);
 }
 
-static void menu_render_list_item_at_index(struct menu_t *menu, struct menu_item_t *item, uint8_t index, bool selected)
+static int menu_plot_y(const struct item_plot_t *plot, int32_t value)
 {
-    if (!menu || !item || index >= item->list.num_options) {
+    int32_t range = MAX(plot->max - plot->min, 1);
+
+    value = CLAMP(value, plot->min, plot->max);
+    return (plot->height - 1) - (int64_t)(value - plot->min) * (plot->height - 1) / range;
+}
+
+/*
+ * A column shows the newest sample that landed on it, joined to the one
+ * before by a vertical span. The column after the newest sample is the
+ * cursor and stays blank.
+ */
+static void menu_render_plot_column(struct menu_t *menu, struct menu_item_t *item, uint16_t x, uint16_t y, uint16_t col, uint16_t color)
+{
+    const struct item_plot_t *plot = &item->plot;
+    uint32_t first = plot->count >= plot->width ? plot->count - plot->width + 1 : 0;
+    uint32_t k;
+    int y0, y1;
+
+    pannel_render_rect(menu->pannel, x + col, y, 1, plot->height, COLOR_BLACK, true);
+
+    if (!plot->count || col > plot->count - 1) {
         return;
     }
 
+    k = plot->count - 1 - (plot->count - 1 - col) % plot->width;
+    if (k < first) {
+        return;
+    }
+
+    y1 = menu_plot_y(plot, plot->samples[k % plot->width]);
+    /* the cursor slot still holds the sample before the oldest one shown */
+    y0 = k ? menu_plot_y(plot, plot->samples[(k - 1) % plot->width]) : y1;
+
+    pannel_render_rect(menu->pannel, x + col, y + MIN(y0, y1), 1, abs(y1 - y0) + 1, color, true);
+}
+
+/* plots, bars and gauges draw in green unless the item sets a color */
+static uint16_t menu_item_chart_color(struct menu_item_t *item)
+{
+    if (item->style & MENU_STYLE_CUSTOM_COLOR) {
+        return item->style >> MENU_STYLE_COLOR_SHIFT;
+    }
+
+    return COLOR_GREEN;
+}
+
+static void menu_render_plot(struct menu_t *menu, struct menu_item_t *item, uint16_t x, uint16_t y)
+{
+    const struct item_plot_t *plot = &item->plot;
+    uint16_t color = menu_item_chart_color(item);
+    uint16_t col;
+
+    y += 2;
+    for (col = 0; col < plot->width; col++) {
+        /* an update damages two columns, skip the rest early */
+        if (pannel_clip_test(menu->pannel, x + col, y, 1, plot->height)) {
+            menu_render_plot_column(menu, item, x, y, col, color);
+        }
+    }
+}
+
+static uint16_t menu_bar_level(const struct item_bar_t *bar, uint16_t steps)
+{
+    int32_t range = MAX(bar->max - bar->min, 1);
+    int32_t value = CLAMP(bar->value, bar->min, bar->max);
+
+    return (int64_t)(value - bar->min) * steps / range;
+}
+
+/* the bar frame sits right of the name, its level is the filled width inside */
+static void menu_bar_area(struct menu_item_t *item, uint16_t x, uint16_t y, uint16_t width, struct pannel_rect *area)
+{
+    uint16_t label = 0;
+
+    if (!(item->style & MENU_STYLE_VALUE_ONLY) && item->name[0] != '\0') {
+        label = (strlen((const char *)item->name) + 1) * CONFIG_FONT_WIDTH;
+    }
+
+    /* loose items get no width from a group */
+    if (!width) {
+        width = label + 8 * CONFIG_FONT_WIDTH;
+    }
+
+    area->x = x + label;
+    area->y = y + 2;
+    area->w = (width > label + 2) ? width - label : 2;
+    area->h = CONFIG_FONT_HEIGHT;
+}
+
+static void menu_render_bar(struct menu_t *menu, struct menu_item_t *item, uint16_t x, uint16_t y, uint16_t width)
+{
+    struct item_bar_t *bar = &item->bar;
+    uint16_t color = menu_item_chart_color(item);
+    struct pannel_rect area;
+    uint16_t level;
+
+    menu_bar_area(item, x, y, width, &area);
+    level = menu_bar_level(bar, area.w - 2);
+
+    if (area.x > x) {
+        pannel_render_txt_bg(menu->pannel, item->name, x, area.y, COLOR_WHITE, COLOR_BLACK);
+    }
+
+    pannel_render_rect(menu->pannel, area.x, area.y, area.w, area.h, color, false);
+    pannel_render_rect(menu->pannel, area.x + 1, area.y + 1, level, area.h - 2, color, true);
+    pannel_render_rect(menu->pannel, area.x + 1 + level, area.y + 1, area.w - 2 - level, area.h - 2, COLOR_BLACK, true);
+
+    bar->rendered_level = level;
+}
+
+/* the needle sweeps clockwise from bottom left at min to bottom right at max */
+static void menu_gauge_tip(const struct item_bar_t *bar, int cx, int cy, uint16_t level, int *tx, int *ty)
+{
+    float angle = (225.0f - 270.0f * level / MENU_GAUGE_STEPS) * (float)M_PI / 180.0f;
+    int len = MAX(bar->radius - 2, 0);
+
+    *tx = cx + lroundf(len * cosf(angle));
+    *ty = cy - lroundf(len * sinf(angle));
+}
+
+static void menu_render_gauge(struct menu_t *menu, struct menu_item_t *item, uint16_t x, uint16_t y)
+{
+    struct item_bar_t *bar = &item->bar;
+    uint16_t color = menu_item_chart_color(item);
+    int cx = x + bar->radius;
+    int cy = y + 2 + bar->radius;
+    uint16_t level = menu_bar_level(bar, MENU_GAUGE_STEPS);
+    int tx, ty;
+
+    menu_gauge_tip(bar, cx, cy, level, &tx, &ty);
+
+    pannel_render_circle(menu->pannel, cx, cy, bar->radius, color);
+    pannel_render_line(menu->pannel, cx, cy, tx, ty, color);
+
+    bar->rendered_level = level;
+}
+
+/* where the text of option index starts in the list editor */
+static void menu_list_option_pos(struct menu_t *menu, struct menu_item_t *item, uint8_t index, uint16_t *x, uint16_t *y)
+{
     struct display_capabilities *caps;
     pannel_get_capabilities(menu->pannel, &caps);
 
     uint16_t start_y = 15;
     uint16_t step_y = CONFIG_FONT_HEIGHT + 5;
     uint16_t step_x = 8 * CONFIG_FONT_WIDTH;
-
-    uint16_t text_color = selected ? COLOR_BLACK : COLOR_WHITE;
-    uint16_t bg_color = selected ? COLOR_WHITE : COLOR_BLACK;
-    uint16_t current_x;
-    uint16_t current_y = start_y;
-
     uint16_t text_width = strlen(item->list.options[index]) * CONFIG_FONT_WIDTH;
 
+    *y = start_y;
     if (item->list.layout & MENU_LAYOUT_VERTICAL) {
-        current_y += index * step_y;
-        current_x = (caps->x_resolution / 2) - (text_width / 2);
+        *y += index * step_y;
+        *x = (caps->x_resolution / 2) - (text_width / 2);
     } else {
-        current_x = 10;
-        current_x += index * step_x;
+        *x = 10;
+        *x += index * step_x;
     }
+}
+
+static void menu_render_list_item_at_index(struct menu_t *menu, struct menu_item_t *item, uint8_t index, bool selected)
+{
+    if (!menu || !item || index >= item->list.num_options) {
+        return;
+    }
+
+    uint16_t text_color = selected ? COLOR_BLACK : COLOR_WHITE;
+    uint16_t bg_color = selected ? COLOR_WHITE : COLOR_BLACK;
+    uint16_t current_x;
+    uint16_t current_y;
+
+    menu_list_option_pos(menu, item, index, &current_x, &current_y);
 
     pannel_render_rect(menu->pannel, current_x - 2, current_y, strlen(item->list.options[index]) * CONFIG_FONT_WIDTH + 4, CONFIG_FONT_HEIGHT + 4, bg_color, true);
-    pannel_render_txt(menu->pannel, (uint8_t *)item->list.options[index], current_x, current_y + 2, text_color);
+    pannel_render_txt_bg(menu->pannel, (uint8_t *)item->list.options[index], current_x, current_y + 2, text_color, bg_color);
 }
 
 static void menu_render_list_editing(struct menu_t *menu, struct menu_item_t *item)
@@ -346,7 +564,7 @@ static void menu_render_list_editing(struct menu_t *menu, struct menu_item_t *it
         uint16_t title_width = title_len * CONFIG_FONT_WIDTH;
         uint16_t title_x = (caps->x_resolution / 2) - (title_width / 2);
         pannel_render_rect(menu->pannel, title_x - 2, 5, title_width + 4, 1, COLOR_BLACK, true);
-        pannel_render_txt(menu->pannel, (uint8_t *)item->list.title, title_x, 5 - (CONFIG_FONT_HEIGHT / 2), COLOR_WHITE);
+        pannel_render_txt_bg(menu->pannel, (uint8_t *)item->list.title, title_x, 5 - (CONFIG_FONT_HEIGHT / 2), COLOR_WHITE, COLOR_BLACK);
     }
 
     for (uint8_t i = 0; i < item->list.num_options; i++) {
@@ -356,24 +574,41 @@ static void menu_render_list_editing(struct menu_t *menu, struct menu_item_t *it
 }
 
 
+/* row of the min (0), max (1) or button (2, 3) part of the min/max editor */
+static uint16_t menu_min_max_part_y(uint8_t target)
+{
+    if (target == 0) {
+        return 20;
+    } else if (target == 1) {
+        return 20 + CONFIG_FONT_HEIGHT + 10;
+    }
+
+    return 20 + CONFIG_FONT_HEIGHT + 10 + CONFIG_FONT_HEIGHT + 15;
+}
+
 static void menu_render_input_min_max_item_part(struct menu_t *menu, struct menu_item_t *item, uint8_t target, bool selected)
 {
    struct display_capabilities *caps;
    pannel_get_capabilities(menu->pannel, &caps);
    char buf[32];
+   struct text_buf text;
+
+   text_init(&text, buf, sizeof(buf));
 
    if (target == 0) { // Min
-       uint16_t y_pos = 20;
-       snprintf(buf, sizeof(buf), "Min: %d", item->input_min_max.editing_min_value);
+       uint16_t y_pos = menu_min_max_part_y(target);
+       text_append(&text, "Min: ");
+       text_append_int(&text, item->input_min_max.editing_min_value);
        pannel_render_rect(menu->pannel, 10, y_pos, caps->x_resolution - 20, CONFIG_FONT_HEIGHT + 4, selected ? COLOR_WHITE : COLOR_BLACK, true);
-       pannel_render_txt(menu->pannel, (uint8_t *)buf, 12, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE);
+       pannel_render_txt_bg(menu->pannel, (uint8_t *)buf, 12, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE, selected ? COLOR_WHITE : COLOR_BLACK);
    } else if (target == 1) { // Max
-       uint16_t y_pos = 20 + CONFIG_FONT_HEIGHT + 10;
-       snprintf(buf, sizeof(buf), "Max: %d", item->input_min_max.editing_max_value);
+       uint16_t y_pos = menu_min_max_part_y(target);
+       text_append(&text, "Max: ");
+       text_append_int(&text, item->input_min_max.editing_max_value);
        pannel_render_rect(menu->pannel, 10, y_pos, caps->x_resolution - 20, CONFIG_FONT_HEIGHT + 4, selected ? COLOR_WHITE : COLOR_BLACK, true);
-       pannel_render_txt(menu->pannel, (uint8_t *)buf, 12, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE);
+       pannel_render_txt_bg(menu->pannel, (uint8_t *)buf, 12, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE, selected ? COLOR_WHITE : COLOR_BLACK);
    } else { // Buttons
-       uint16_t y_pos = 20 + CONFIG_FONT_HEIGHT + 10 + CONFIG_FONT_HEIGHT + 15;
+       uint16_t y_pos = menu_min_max_part_y(target);
        uint16_t button_width = 40;
        uint16_t button_spacing = 20;
        uint16_t total_buttons_width = 2 * button_width + button_spacing;
@@ -381,10 +616,10 @@ static void menu_render_input_min_max_item_part(struct menu_t *menu, struct menu
 
        if (target == 2) { // OK
            pannel_render_rect(menu->pannel, buttons_x_start, y_pos, button_width, CONFIG_FONT_HEIGHT + 4, selected ? COLOR_WHITE : COLOR_BLACK, true);
-           pannel_render_txt(menu->pannel, (uint8_t *)"OK", buttons_x_start + (button_width - 2 * CONFIG_FONT_WIDTH) / 2, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE);
+           pannel_render_txt_bg(menu->pannel, (uint8_t *)"OK", buttons_x_start + (button_width - 2 * CONFIG_FONT_WIDTH) / 2, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE, selected ? COLOR_WHITE : COLOR_BLACK);
        } else if (target == 3) { // Cancel
            pannel_render_rect(menu->pannel, buttons_x_start + button_width + button_spacing, y_pos, button_width, CONFIG_FONT_HEIGHT + 4, selected ? COLOR_WHITE : COLOR_BLACK, true);
-           pannel_render_txt(menu->pannel, (uint8_t *)"Cancel", buttons_x_start + button_width + button_spacing + (button_width - 6 * CONFIG_FONT_WIDTH) / 2, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE);
+           pannel_render_txt_bg(menu->pannel, (uint8_t *)"Cancel", buttons_x_start + button_width + button_spacing + (button_width - 6 * CONFIG_FONT_WIDTH) / 2, y_pos + 2, selected ? COLOR_BLACK : COLOR_WHITE, selected ? COLOR_WHITE : COLOR_BLACK);
        }
    }
 }
@@ -404,7 +639,7 @@ static void menu_render_input_min_max_editing(struct menu_t *menu, struct menu_i
     uint16_t title_width = title_len * CONFIG_FONT_WIDTH;
     uint16_t title_x = (caps->x_resolution / 2) - (title_width / 2);
     pannel_render_rect(menu->pannel, title_x - 2, 5, title_width + 4, 1, COLOR_BLACK, true);
-    pannel_render_txt(menu->pannel, (uint8_t *)item->name, title_x, 5 - (CONFIG_FONT_HEIGHT / 2), COLOR_WHITE);
+    pannel_render_txt_bg(menu->pannel, (uint8_t *)item->name, title_x, 5 - (CONFIG_FONT_HEIGHT / 2), COLOR_WHITE, COLOR_BLACK);
 
    menu_render_input_min_max_item_part(menu, item, 0, item->input_min_max.editing_target == 0);
    menu_render_input_min_max_item_part(menu, item, 1, item->input_min_max.editing_target == 1);
@@ -412,45 +647,120 @@ static void menu_render_input_min_max_editing(struct menu_t *menu, struct menu_i
    menu_render_input_min_max_item_part(menu, item, 3, item->input_min_max.editing_target == 3);
 }
 
-static void menu_render_group(struct menu_t *menu, struct menu_group_t *group)
+/* rows are one line of text, plots and gauges are as tall as their chart */
+static uint16_t menu_item_height(struct menu_item_t *item)
 {
-    if (!menu || !group || !group->visible) {
-        return;
+    if (item->type == MENU_ITEM_TYPE_PLOT) {
+        return item->plot.height + 5;
     }
 
-    menu_render_group_chrome(menu, group);
+    if (item->type == MENU_ITEM_TYPE_GAUGE) {
+        return 2 * item->bar.radius + 1 + 5;
+    }
+
+    return CONFIG_FONT_HEIGHT + 5;
+}
 
-    uint16_t total_height = 0;
-    struct menu_item_t *item = group->items;
-    int visible_items = 0;
-    while (item) {
+/* row positions only change with the group's visible items or alignment */
+static void menu_group_layout(struct menu_group_t *group)
+{
+    struct menu_item_t *item;
+    int items_height = 0;
+
+    if (group->layout_valid) {
+        return;
+    }
+
+    for (item = group->items; item; item = item->group_next) {
         if (item->visible) {
-            visible_items++;
+            items_height += menu_item_height(item);
         }
-        item = item->group_next;
     }
-    total_height = visible_items * (CONFIG_FONT_HEIGHT + 5);
 
-    uint16_t start_x = group->x + 5;
-    uint16_t start_y = group->y + 5;
+    uint16_t current_y = group->y + 5;
     if (group->align & MENU_ALIGN_V_CENTER) {
-        start_y = group->y + (group->height - total_height) / 2;
+        current_y = group->y + (group->height - items_height) / 2;
+    }
+
+    for (item = group->items; item; item = item->group_next) {
+        if (item->visible) {
+            item->layout_y = current_y;
+            current_y += menu_item_height(item);
+        }
     }
 
+    group->layout_valid = true;
+}
+
+static void menu_group_layout_invalidate(struct menu_group_t *group)
+{
+    if (group) {
+        group->layout_valid = false;
+    }
+}
+
+static void menu_render_group(struct menu_t *menu, struct menu_group_t *group)
+{
+    if (!menu || !group || !group->visible) {
+        return;
+    }
+
+    /* the title sits half a line above the frame */
+    if (!pannel_clip_test(menu->pannel, group->x, group->y - CONFIG_FONT_HEIGHT / 2,
+                          group->width, group->height + CONFIG_FONT_HEIGHT / 2)) {
+        return;
+    }
+
+    menu_render_group_chrome(menu, group);
+
+    menu_group_layout(group);
+
+    uint16_t start_x = group->x + 5;
     uint16_t render_width = group->width - 10;
 
-    item = group->items;
-    uint16_t current_y = start_y;
-    while (item) {
+    struct menu_item_t *item;
+    for (item = group->items; item; item = item->group_next) {
         if (item->visible) {
-            bool selected = (item == menu->current_item);
-            menu_render_item(menu, item, start_x, current_y, selected, render_width);
-            current_y += CONFIG_FONT_HEIGHT + 5;
+            bool selected = (item == menu->view.current_item);
+            if (pannel_clip_test(menu->pannel, start_x - 2, item->layout_y, render_width + 4, menu_item_height(item))) {
+                menu_render_item(menu, item, start_x, item->layout_y, selected, render_width);
+            }
         }
-        item = item->group_next;
     }
 }
 
+/* the outermost unlock sends everything drawn under the lock to the display */
+static void menu_pannel_lock(struct menu_t *menu)
+{
+    k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
+    menu->pannel_depth++;
+}
+
+static void menu_pannel_unlock(struct menu_t *menu)
+{
+    if (--menu->pannel_depth == 0)
+        pannel_flush(menu->pannel);
+    k_mutex_unlock(&menu->pannel_mutex);
+}
+
+static void menu_view_take(struct menu_t *menu)
+{
+    struct menu_view *view = &menu->view;
+
+    k_mutex_lock(&menu->state_mutex, K_FOREVER);
+
+    view->current_item = menu->current_item;
+    view->editing_item = menu->editing_item;
+    view->group_stack_top = menu->group_stack_top;
+    view->dialog = menu->dialog_item != NULL;
+    if (view->dialog) {
+        view->dialog_selected_button = menu->dialog_selected_button;
+        view->dialog_item = menu->dialog_item->dialog;
+    }
+
+    k_mutex_unlock(&menu->state_mutex);
+}
+
 static void menu_render(struct menu_t *menu)
 {
     struct display_capabilities *caps;
@@ -459,10 +769,10 @@ static void menu_render(struct menu_t *menu)
         return;
     }
 
-   if (menu->dialog_item) {
-       k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-       menu_render_dialog(menu, menu->dialog_item);
-       k_mutex_unlock(&menu->pannel_mutex);
+   if (menu->view.dialog) {
+       menu_pannel_lock(menu);
+       menu_render_dialog(menu, &menu->view.dialog_item);
+       menu_pannel_unlock(menu);
        return;
    }
 
@@ -470,13 +780,13 @@ static void menu_render(struct menu_t *menu)
     
     pannel_render_clear(menu->pannel, COLOR_BLACK);
 
-    if (menu->editing_item && menu->editing_item->type == MENU_ITEM_TYPE_LIST) {
-        menu_render_list_editing(menu, menu->editing_item);
+    if (menu->view.editing_item && menu->view.editing_item->type == MENU_ITEM_TYPE_LIST) {
+        menu_render_list_editing(menu, menu->view.editing_item);
         return;
     }
 
-   if (menu->editing_item && menu->editing_item->type == MENU_ITEM_TYPE_INPUT_MIN_MAX) {
-       menu_render_input_min_max_editing(menu, menu->editing_item);
+   if (menu->view.editing_item && menu->view.editing_item->type == MENU_ITEM_TYPE_INPUT_MIN_MAX) {
+       menu_render_input_min_max_editing(menu, menu->view.editing_item);
        return;
    }
 
@@ -486,15 +796,15 @@ static void menu_render(struct menu_t *menu)
         group = group->next;
     }
 
-    if (menu->group_stack_top == -1) {
+    if (menu->view.group_stack_top == -1) {
         uint16_t y = 10;
         uint16_t x = 10;
         struct menu_item_t *item = menu->item;
         while (item) {
             if (!item->group) {
-                bool selected = (item == menu->current_item);
+                bool selected = (item == menu->view.current_item);
                 menu_render_item(menu, item, x, y, selected, 0);
-                y += CONFIG_FONT_HEIGHT + 5;
+                y += menu_item_height(item);
                 if (y > caps->y_resolution) {
                     break;
                 }
@@ -504,19 +814,205 @@ static void menu_render(struct menu_t *menu)
     }
 }
 
-static void menu_refresh_group(struct menu_t *menu, struct menu_group_t *group)
+/* queue a screen area for repaint, merged like the panel's own dirty list */
+static void menu_damage_add(struct menu_t *menu, int x, int y, int w, int h)
 {
-    if (!menu || !group || !group->visible) {
+    struct display_capabilities *caps;
+    struct pannel_rect r;
+
+    pannel_get_capabilities(menu->pannel, &caps);
+
+    w = MIN(x + w, caps->x_resolution) - MAX(x, 0);
+    h = MIN(y + h, caps->y_resolution) - MAX(y, 0);
+    if (w <= 0 || h <= 0) {
         return;
     }
 
-    k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
+    r.x = MAX(x, 0);
+    r.y = MAX(y, 0);
+    r.w = w;
+    r.h = h;
 
-    pannel_render_rect(menu->pannel, group->x, group->y, group->width, group->height, COLOR_BLACK, true);
+    pannel_rect_list_add(menu->damage, &menu->damage_count, MENU_DAMAGE_MAX, &r);
+}
 
-    menu_render_group(menu, group);
+static void menu_damage_screen(struct menu_t *menu)
+{
+    menu_damage_add(menu, 0, 0, UINT16_MAX, UINT16_MAX);
+}
 
-    k_mutex_unlock(&menu->pannel_mutex);
+static void menu_damage_group(struct menu_t *menu, struct menu_group_t *group)
+{
+    menu_damage_add(menu, group->x, group->y - CONFIG_FONT_HEIGHT / 2,
+                    group->width, group->height + CONFIG_FONT_HEIGHT / 2);
+}
+
+static void menu_damage_item(struct menu_t *menu, struct menu_item_t *item)
+{
+    uint16_t item_x, item_y, item_w;
+
+    if (!item) {
+        return;
+    }
+
+    if (!item->group) {
+        /* loose items are only laid out by menu_render() */
+        menu_damage_screen(menu);
+        return;
+    }
+
+    if (!item->group->visible) {
+        return;
+    }
+
+    menu_get_item_layout(item->group, item, &item_x, &item_y, &item_w);
+    menu_damage_add(menu, item_x - 2, item_y, item_w + 4, menu_item_height(item));
+}
+
+static void menu_damage_list_option(struct menu_t *menu, struct menu_item_t *item, uint8_t index)
+{
+    uint16_t x, y;
+
+    if (index >= item->list.num_options) {
+        return;
+    }
+
+    menu_list_option_pos(menu, item, index, &x, &y);
+    menu_damage_add(menu, x - 2, y, strlen(item->list.options[index]) * CONFIG_FONT_WIDTH + 4, CONFIG_FONT_HEIGHT + 4);
+}
+
+static void menu_damage_min_max_part(struct menu_t *menu, uint8_t target)
+{
+    struct display_capabilities *caps;
+
+    pannel_get_capabilities(menu->pannel, &caps);
+    menu_damage_add(menu, 10, menu_min_max_part_y(target), caps->x_resolution - 20, CONFIG_FONT_HEIGHT + 4);
+}
+
+/* the button row of the dialog box drawn by menu_render_dialog() */
+static void menu_damage_dialog_buttons(struct menu_t *menu)
+{
+    struct display_capabilities *caps;
+    uint16_t box_w, box_h;
+
+    pannel_get_capabilities(menu->pannel, &caps);
+    box_w = caps->x_resolution * 0.8;
+    box_h = caps->y_resolution * 0.6;
+    menu_damage_add(menu, (caps->x_resolution - box_w) / 2,
+                    (caps->y_resolution - box_h) / 2 + box_h - CONFIG_FONT_HEIGHT - 10,
+                    box_w, CONFIG_FONT_HEIGHT + 4);
+}
+
+static void menu_plot_push(struct menu_t *menu, struct menu_item_t *item, int32_t value)
+{
+    struct item_plot_t *plot = &item->plot;
+    uint16_t col = plot->count % plot->width;
+
+    plot->samples[col] = value;
+    plot->count++;
+
+    if (!item->group) {
+        menu_damage_screen(menu);
+        return;
+    }
+
+    if (!item->visible || !item->group->visible) {
+        return;
+    }
+
+    /* the new column and the cursor after it */
+    menu_group_layout(item->group);
+    menu_damage_add(menu, item->group->x + 5 + col, item->layout_y + 2, 1, plot->height);
+    menu_damage_add(menu, item->group->x + 5 + (col + 1) % plot->width, item->layout_y + 2, 1, plot->height);
+}
+
+/* only what lies between the level on screen and the new one is repainted */
+static void menu_damage_level(struct menu_t *menu, struct menu_item_t *item)
+{
+    struct item_bar_t *bar = &item->bar;
+    uint16_t x, y, level;
+
+    if (!item->group) {
+        menu_damage_screen(menu);
+        return;
+    }
+
+    if (!item->visible || !item->group->visible) {
+        return;
+    }
+
+    menu_group_layout(item->group);
+    x = item->group->x + 5;
+    y = item->layout_y;
+
+    if (item->type == MENU_ITEM_TYPE_BAR) {
+        struct pannel_rect area;
+
+        menu_bar_area(item, x, y, item->group->width - 10, &area);
+        level = menu_bar_level(bar, area.w - 2);
+        if (level != bar->rendered_level) {
+            menu_damage_add(menu, area.x + 1 + MIN(level, bar->rendered_level), area.y + 1,
+                            abs(level - bar->rendered_level), area.h - 2);
+        }
+    } else {
+        int cx = x + bar->radius;
+        int cy = y + 2 + bar->radius;
+        int ox, oy, nx, ny;
+
+        level = menu_bar_level(bar, MENU_GAUGE_STEPS);
+        if (level != bar->rendered_level) {
+            menu_gauge_tip(bar, cx, cy, bar->rendered_level, &ox, &oy);
+            menu_gauge_tip(bar, cx, cy, level, &nx, &ny);
+            menu_damage_add(menu, MIN(cx, MIN(ox, nx)), MIN(cy, MIN(oy, ny)),
+                            MAX(cx, MAX(ox, nx)) - MIN(cx, MIN(ox, nx)) + 1,
+                            MAX(cy, MAX(oy, ny)) - MIN(cy, MIN(oy, ny)) + 1);
+        }
+    }
+}
+
+/* repaint each damaged area clipped to itself, all of them in one batch */
+static void menu_repaint(struct menu_t *menu)
+{
+    int i;
+
+    if (!menu->damage_count) {
+        return;
+    }
+
+    menu_pannel_lock(menu);
+
+    for (i = 0; i < menu->damage_count; i++) {
+        pannel_clip_set(menu->pannel, &menu->damage[i]);
+        menu_render(menu);
+    }
+    pannel_clip_set(menu->pannel, NULL);
+    menu->damage_count = 0;
+
+    pannel_frame_end(menu->pannel);
+    menu_pannel_unlock(menu);
+}
+
+/* read-only items never take the cursor */
+static bool menu_item_navigable(const struct menu_item_t *item)
+{
+    return item->type != MENU_ITEM_TYPE_LABEL && item->type != MENU_ITEM_TYPE_PLOT &&
+           item->type != MENU_ITEM_TYPE_BAR && item->type != MENU_ITEM_TYPE_GAUGE;
+}
+
+/*
+ * User callbacks may block, show a dialog or call back into the menu. The
+ * input is processed with state_mutex taken once, so dropping it here really
+ * releases it for the duration of the callback.
+ */
+static bool menu_input_cb_call(struct menu_t *menu, struct menu_item_t *item, menu_input_event_t *ev)
+{
+    bool ret;
+
+    k_mutex_unlock(&menu->state_mutex);
+    ret = item->input.cb(item, ev);
+    k_mutex_lock(&menu->state_mutex, K_FOREVER);
+
+    return ret;
 }
 
 static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
@@ -542,7 +1038,7 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
     switch (event->type) {
         case INPUT_TYPE_QDEC:
             if (menu->editing_item && menu->editing_item->input.dev == event->dev) {
-                if (menu->editing_item->input.cb && !menu->editing_item->input.cb(menu->editing_item, event)) {
+                if (menu->editing_item->input.cb && !menu_input_cb_call(menu, menu->editing_item, event)) {
                     break;
                 }
                 menu->editing_item->input.user_adjusted = true;
@@ -568,10 +1064,8 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                 }
 
                 if (last_index != menu->editing_item->list.editing_index) {
-                    k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-                    menu_render_list_item_at_index(menu, menu->editing_item, last_index, false);
-                    menu_render_list_item_at_index(menu, menu->editing_item, menu->editing_item->list.editing_index, true);
-                    k_mutex_unlock(&menu->pannel_mutex);
+                    menu_damage_list_option(menu, menu->editing_item, last_index);
+                    menu_damage_list_option(menu, menu->editing_item, menu->editing_item->list.editing_index);
                 }
            } else if (menu->editing_item && menu->editing_item->type == MENU_ITEM_TYPE_INPUT_MIN_MAX) {
                struct item_input_min_max_t *min_max = &menu->editing_item->input_min_max;
@@ -595,18 +1089,14 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                        }
                    }
 
-                   k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-                   menu_render_input_min_max_item_part(menu, menu->editing_item, min_max->editing_target, true);
-                   k_mutex_unlock(&menu->pannel_mutex);
+                   menu_damage_min_max_part(menu, min_max->editing_target);
                } else {
                    if (event->value != 0) {
                        uint8_t old_target = min_max->editing_target;
                        min_max->editing_target = (old_target == 2) ? 3 : 2;
 
-                       k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-                       menu_render_input_min_max_item_part(menu, menu->editing_item, old_target, false);
-                       menu_render_input_min_max_item_part(menu, menu->editing_item, min_max->editing_target, true);
-                       k_mutex_unlock(&menu->pannel_mutex);
+                       menu_damage_min_max_part(menu, old_target);
+                       menu_damage_min_max_part(menu, min_max->editing_target);
                    }
                }
             } else if (menu->group_stack_top > -1) {
@@ -615,7 +1105,7 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                 }
                 if (event->value > 0) {
                     struct menu_item_t *next_item = menu->current_item->group_next;
-                    while (next_item && (next_item->type == MENU_ITEM_TYPE_LABEL || !next_item->visible || (next_item->style & MENU_STYLE_NON_NAVIGABLE))) {
+                    while (next_item && (!menu_item_navigable(next_item) || !next_item->visible || (next_item->style & MENU_STYLE_NON_NAVIGABLE))) {
                         next_item = next_item->group_next;
                     }
                     if (next_item) {
@@ -623,7 +1113,7 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                     }
                 } else if (event->value < 0) {
                     struct menu_item_t *prev_item = menu->current_item->group_prev;
-                    while (prev_item && (prev_item->type == MENU_ITEM_TYPE_LABEL || !prev_item->visible || (prev_item->style & MENU_STYLE_NON_NAVIGABLE))) {
+                    while (prev_item && (!menu_item_navigable(prev_item) || !prev_item->visible || (prev_item->style & MENU_STYLE_NON_NAVIGABLE))) {
                         prev_item = prev_item->group_prev;
                     }
                     if (prev_item) {
@@ -638,11 +1128,11 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                 if (event->value > 0) {
                     struct menu_item_t *next_item = menu->current_item->next;
                     while (next_item) {
-                        bool is_label = next_item->type == MENU_ITEM_TYPE_LABEL;
+                        bool is_read_only = !menu_item_navigable(next_item);
                         bool is_hidden = !next_item->visible;
                         bool in_inactive_group = next_item->group && !next_item->group->always_visible && next_item->group->bind_item != NULL;
                         bool is_non_navigable = next_item->style & MENU_STYLE_NON_NAVIGABLE;
-                        if (is_label || is_hidden || in_inactive_group || is_non_navigable) {
+                        if (is_read_only || is_hidden || in_inactive_group || is_non_navigable) {
                             next_item = next_item->next;
                         } else {
                             break;
@@ -654,11 +1144,11 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                 } else if (event->value < 0) {
                     struct menu_item_t *prev_item = menu->current_item->prev;
                     while (prev_item) {
-                        bool is_label = prev_item->type == MENU_ITEM_TYPE_LABEL;
+                        bool is_read_only = !menu_item_navigable(prev_item);
                         bool is_hidden = !prev_item->visible;
                         bool in_inactive_group = prev_item->group && !prev_item->group->always_visible && prev_item->group->bind_item != NULL;
                         bool is_non_navigable = prev_item->style & MENU_STYLE_NON_NAVIGABLE;
-                        if (is_label || is_hidden || in_inactive_group || is_non_navigable) {
+                        if (is_read_only || is_hidden || in_inactive_group || is_non_navigable) {
                             prev_item = prev_item->prev;
                         } else {
                             break;
@@ -680,15 +1170,15 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
 
                        if (min_max->editing_target < 2) {
                            min_max->editing_target++;
-                           k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-                           menu_render_input_min_max_item_part(menu, menu->editing_item, old_target, false);
-                           menu_render_input_min_max_item_part(menu, menu->editing_item, min_max->editing_target, true);
-                           k_mutex_unlock(&menu->pannel_mutex);
+                           menu_damage_min_max_part(menu, old_target);
+                           menu_damage_min_max_part(menu, min_max->editing_target);
                        } else if (min_max->editing_target == 2) {
                            min_max->min_value = min_max->editing_min_value;
                            min_max->max_value = min_max->editing_max_value;
                            if (min_max->cb) {
+                               k_mutex_unlock(&menu->state_mutex);
                                min_max->cb(menu->editing_item, min_max->min_value, min_max->max_value);
+                               k_mutex_lock(&menu->state_mutex, K_FOREVER);
                            }
                            menu->editing_item = NULL;
                            force_render = true;
@@ -703,7 +1193,7 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                            case MENU_ITEM_TYPE_INPUT:
                                item_exiting_edit->input.value = item_exiting_edit->input.editing_value;
                                if (item_exiting_edit->input.cb) {
-                                   if (item_exiting_edit->input.cb(item_exiting_edit, &ev)) {
+                                   if (menu_input_cb_call(menu, item_exiting_edit, &ev)) {
                                        item_exiting_edit->input.value = ev.value;
                                    }
                                }
@@ -711,13 +1201,17 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                            case MENU_ITEM_TYPE_SWITCH:
                                item_exiting_edit->switch_ctrl.is_on = item_exiting_edit->switch_ctrl.editing_is_on;
                                if (item_exiting_edit->switch_ctrl.cb) {
+                                   k_mutex_unlock(&menu->state_mutex);
                                    item_exiting_edit->switch_ctrl.cb(item_exiting_edit, item_exiting_edit->switch_ctrl.is_on);
+                                   k_mutex_lock(&menu->state_mutex, K_FOREVER);
                                }
                                break;
                            case MENU_ITEM_TYPE_LIST:
                                item_exiting_edit->list.selected_index = item_exiting_edit->list.editing_index;
                                if (item_exiting_edit->list.cb) {
+                                   k_mutex_unlock(&menu->state_mutex);
                                    item_exiting_edit->list.cb(item_exiting_edit, item_exiting_edit->list.selected_index);
+                                   k_mutex_lock(&menu->state_mutex, K_FOREVER);
                                }
                                break;
                            default:
@@ -745,7 +1239,7 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                             menu->editing_item->input.editing_value = menu->editing_item->input.live_value;
                             menu->editing_item->input.user_adjusted = false;
                             if (menu->editing_item->input.cb) {
-                                if (menu->editing_item->input.cb(menu->editing_item, &ev)) {
+                                if (menu_input_cb_call(menu, menu->editing_item, &ev)) {
                                     menu->editing_item->input.editing_value = ev.value;
                                 }
                             }
@@ -795,7 +1289,7 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                                         force_render = true;
 
                                         struct menu_item_t *first_item = bound_group->items;
-                                        while(first_item && (first_item->type == MENU_ITEM_TYPE_LABEL || !first_item->visible)) {
+                                        while(first_item && (!menu_item_navigable(first_item) || !first_item->visible || (first_item->style & MENU_STYLE_NON_NAVIGABLE))) {
                                             first_item = first_item->group_next;
                                         }
                                         if (first_item) {
@@ -805,7 +1299,11 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                                 } else if (menu->current_item->items) {
                                     menu->current_item = menu->current_item->items;
                                 } else if (menu->current_item->cb) {
-                                    menu->current_item->cb(menu->current_item, menu->current_item->id);
+                                    struct menu_item_t *item = menu->current_item;
+
+                                    k_mutex_unlock(&menu->state_mutex);
+                                    item->cb(item, item->id);
+                                    k_mutex_lock(&menu->state_mutex, K_FOREVER);
                                     force_render = true;
                                 }
                             }
@@ -824,7 +1322,7 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
                    } else {
                        struct menu_item_t *item_exiting_edit = menu->editing_item;
                        if (item_exiting_edit->type == MENU_ITEM_TYPE_INPUT && item_exiting_edit->input.cb) {
-                           item_exiting_edit->input.cb(item_exiting_edit, NULL); // Notify callback of cancellation
+                           menu_input_cb_call(menu, item_exiting_edit, NULL); // Notify callback of cancellation
                        }
                        
                        if (item_exiting_edit->type == MENU_ITEM_TYPE_INPUT || item_exiting_edit->type == MENU_ITEM_TYPE_SWITCH) {
@@ -883,6 +1381,9 @@ static void menu_process_input(struct menu_t *menu, menu_input_event_t *event)
             menu->needs_render = true;
         }
         k_sem_give(&menu->render_sem);
+    } else if (menu->damage_count) {
+        /* an editor part changed, it is drawn with the next repaint */
+        k_sem_give(&menu->render_sem);
     }
     k_mutex_unlock(&menu->state_mutex);
 }
@@ -892,11 +1393,63 @@ int menu_input_event(struct menu_t *menu, menu_input_event_t *event)
     if (!menu || !event) {
         return -EINVAL;
     }
-    
-    menu_process_input(menu, event);
+
+    if (event->type == INPUT_TYPE_QDEC) {
+        atomic_add(&menu->qdec_steps, event->value > 0 ? 1 : -1);
+    } else {
+        uint32_t head = atomic_get(&menu->key_head);
+        struct menu_key_slot *slot;
+
+        if (head - (uint32_t)atomic_get(&menu->key_tail) >= MENU_KEY_QUEUE_SIZE) {
+            return -ENOBUFS;
+        }
+
+        slot = &menu->key_queue[head % MENU_KEY_QUEUE_SIZE];
+        slot->event = *event;
+        /* steps turned before the key belong in front of it */
+        slot->qdec_steps = atomic_set(&menu->qdec_steps, 0);
+        atomic_set(&menu->key_head, head + 1);
+    }
+
+    k_poll_signal_raise(&menu->input_signal, 0);
     return 0;
 }
 
+static void menu_process_qdec_steps(struct menu_t *menu, int32_t steps)
+{
+    menu_input_event_t ev = {
+        .type = INPUT_TYPE_QDEC,
+        .dev = menu->qdec_dev,
+    };
+
+    /* a spin faster than the menu can follow is not replayed in full */
+    steps = CLAMP(steps, -MENU_QDEC_MAX_STEPS, MENU_QDEC_MAX_STEPS);
+    ev.value = steps > 0 ? 1 : -1;
+
+    for (; steps; steps -= ev.value) {
+        menu_process_input(menu, &ev);
+    }
+}
+
+/*
+ * Replays queued input in order. Each event takes state_mutex on its own
+ * and only records what changed, the repaint after it draws all of it.
+ */
+static void menu_input_drain(struct menu_t *menu)
+{
+    uint32_t tail = atomic_get(&menu->key_tail);
+
+    while (tail != (uint32_t)atomic_get(&menu->key_head)) {
+        struct menu_key_slot *slot = &menu->key_queue[tail % MENU_KEY_QUEUE_SIZE];
+
+        menu_process_qdec_steps(menu, slot->qdec_steps);
+        menu_process_input(menu, &slot->event);
+        atomic_set(&menu->key_tail, ++tail);
+    }
+
+    menu_process_qdec_steps(menu, atomic_set(&menu->qdec_steps, 0));
+}
+
 
 static void menu_input_key_cb(struct input_event *evt, void *user_data)
 {
@@ -956,11 +1509,11 @@ static void menu_state_qdec_cb(const struct device *dev,
 
                 if (val > QDEC_THRESHOLD) {
                     ev.value = 1;
-                    menu_process_input(menu, &ev);
+                    menu_input_event(menu, &ev);
                     menu->qdec_value = qdec_val.val1;
                 } else if (val < -QDEC_THRESHOLD) {
                     ev.value = -1;
-                    menu_process_input(menu, &ev);
+                    menu_input_event(menu, &ev);
                     menu->qdec_value = qdec_val.val1;
                 }
             }
@@ -969,46 +1522,6 @@ static void menu_state_qdec_cb(const struct device *dev,
 
 }
 
-static void label_refresh_work_handler(struct k_work *work)
-{
-    struct menu_t *menu = CONTAINER_OF(work, struct menu_t, label_refresh_work);
-    struct menu_group_t *group;
-    struct menu_item_t *item;
-    char new_label_buf[32];
-
-    k_mutex_lock(&menu->state_mutex, K_FOREVER);
-
-    if (menu->dialog_item) {
-        k_mutex_unlock(&menu->state_mutex);
-        return;
-    }
-
-    group = menu->groups;
-    while (group) {
-        if (group->visible) {
-            item = group->items;
-            while (item) {
-                if (item->visible && item->type == MENU_ITEM_TYPE_LABEL && item->label_cb) {
-                    item->label_cb(item, new_label_buf, sizeof(new_label_buf));
-                    if (strcmp(new_label_buf, item->label.rendered_label_str) != 0) {
-                        menu_item_queue_update(item, 0);
-                    }
-                }
-                item = item->group_next;
-            }
-        }
-        group = group->next;
-    }
-
-    k_mutex_unlock(&menu->state_mutex);
-}
-
-static void label_refresh_timer_cb(struct k_timer *timer)
-{
-    struct menu_t *menu = CONTAINER_OF(timer, struct menu_t, label_refresh_timer);
-    k_work_submit(&menu->label_refresh_work);
-}
-
 static void menu_state_machine_func(void *v1, void *v2, void *v3)
 {
     struct menu_t *menu = (struct menu_t *)v1;
@@ -1031,7 +1544,7 @@ static void menu_state_machine_func(void *v1, void *v2, void *v3)
 
     struct menu_item_t *first_item = menu->item;
     while (first_item) {
-        bool is_non_navigable = first_item->style & MENU_STYLE_NON_NAVIGABLE;
+        bool is_non_navigable = !menu_item_navigable(first_item) || (first_item->style & MENU_STYLE_NON_NAVIGABLE);
         bool is_hidden = !first_item->visible;
         bool in_inactive_group = first_item->group && !first_item->group->always_visible && first_item->group->bind_item != NULL;
 
@@ -1047,8 +1560,6 @@ static void menu_state_machine_func(void *v1, void *v2, void *v3)
     menu->needs_render = true;
     k_sem_give(&menu->render_sem);
 
-    k_timer_start(&menu->label_refresh_timer, K_MSEC(500), K_MSEC(500));
-    
     menu->adc2_dev = DEVICE_DT_GET(DT_ALIAS(adc2));
 
     menu->qdec_value = 0;
@@ -1056,51 +1567,82 @@ static void menu_state_machine_func(void *v1, void *v2, void *v3)
     menu->key2_pressed = false;
     menu->adc2_value = 0;
 
-    struct k_poll_event events[2];
+    struct k_poll_event events[3];
     k_poll_event_init(&events[0], K_POLL_TYPE_SEM_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &menu->render_sem);
     k_poll_event_init(&events[1], K_POLL_TYPE_MSGQ_DATA_AVAILABLE, K_POLL_MODE_NOTIFY_ONLY, &menu->update_msgq);
+    k_poll_event_init(&events[2], K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &menu->input_signal);
 
     while (1) {
-        int rc = k_poll(events, 2, K_MSEC(100));
+        /* live values of the edited item are polled, everything else is pushed */
+        int rc = k_poll(events, 3, menu->editing_item ? K_MSEC(100) : K_FOREVER);
 
         if (rc == 0) {
+            if (events[2].state == K_POLL_STATE_SIGNALED) {
+                k_poll_signal_reset(&menu->input_signal);
+                menu_input_drain(menu);
+                if (k_sem_count_get(&menu->render_sem)) {
+                    events[0].state = K_POLL_STATE_SEM_AVAILABLE;
+                }
+            }
+
             if (events[0].state == K_POLL_STATE_SEM_AVAILABLE) {
                 k_sem_take(&menu->render_sem, K_NO_WAIT);
                 k_mutex_lock(&menu->state_mutex, K_FOREVER);
                 if (menu->item_nav_from) {
-                    menu_refresh_item_selection(menu, menu->item_nav_from, menu->item_nav_to);
+                    menu_damage_item(menu, menu->item_nav_from);
+                    menu_damage_item(menu, menu->item_nav_to);
                     menu->item_nav_from = NULL;
                     menu->item_nav_to = NULL;
-                } else if (menu->item_to_refresh) {
-                    menu_refresh_single_item(menu, menu->item_to_refresh);
+                }
+                if (menu->item_to_refresh) {
+                    menu_damage_item(menu, menu->item_to_refresh);
                     menu->item_to_refresh = NULL;
-                } else if (menu->group_to_refresh) {
-                    menu_refresh_group(menu, menu->group_to_refresh);
+                }
+                if (menu->group_to_refresh) {
+                    if (menu->group_to_refresh->visible) {
+                        menu_damage_group(menu, menu->group_to_refresh);
+                    }
                     menu->group_to_refresh = NULL;
-                } else if (menu->needs_render) {
-                    k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-                    menu_render(menu);
-                    k_mutex_unlock(&menu->pannel_mutex);
+                }
+                if (menu->needs_render) {
+                    menu_damage_screen(menu);
                     menu->needs_render = false;
                 }
+                menu_view_take(menu);
                 k_mutex_unlock(&menu->state_mutex);
+                menu_repaint(menu);
             }
 
             if (events[1].state == K_POLL_STATE_MSGQ_DATA_AVAILABLE) {
                 struct menu_update_msg msg;
-                if (k_msgq_get(&menu->update_msgq, &msg, K_NO_WAIT) == 0) {
-                    k_mutex_lock(&menu->state_mutex, K_FOREVER);
+                k_mutex_lock(&menu->state_mutex, K_FOREVER);
+                /* coalesce everything published since the last wakeup into one repaint */
+                while (k_msgq_get(&menu->update_msgq, &msg, K_NO_WAIT) == 0) {
+                    /* plots and meters keep sampling behind a dialog */
+                    if (msg.item && msg.item->type == MENU_ITEM_TYPE_PLOT) {
+                        menu_plot_push(menu, msg.item, msg.value);
+                        continue;
+                    }
+                    if (msg.item && (msg.item->type == MENU_ITEM_TYPE_BAR || msg.item->type == MENU_ITEM_TYPE_GAUGE)) {
+                        msg.item->bar.value = msg.value;
+                        menu_damage_level(menu, msg.item);
+                        continue;
+                    }
                     /* Only process item updates if no dialog is active */
                     if (menu->dialog_item == NULL && msg.item && msg.item != menu->editing_item) {
                         if (msg.item->type == MENU_ITEM_TYPE_INPUT) {
                             msg.item->input.value = msg.value;
                         }
-                        menu_refresh_single_item(menu, msg.item);
+                        menu_damage_item(menu, msg.item);
                     }
-                    k_mutex_unlock(&menu->state_mutex);
                 }
+                menu_view_take(menu);
+                k_mutex_unlock(&menu->state_mutex);
+                menu_repaint(menu);
             }
         } else if (rc == -EAGAIN) {
+            struct menu_item_t *refresh = NULL;
+
             k_mutex_lock(&menu->state_mutex, K_FOREVER);
             if (menu->editing_item) {
                 switch(menu->editing_item->type) {
@@ -1109,9 +1651,9 @@ static void menu_state_machine_func(void *v1, void *v2, void *v3)
                             menu->editing_item->input.editing_value = menu->editing_item->input.live_value;
                         }
                         char editing_value_buf[16];
-                        snprintf(editing_value_buf, sizeof(editing_value_buf), "%d", menu->editing_item->input.editing_value);
+                        text_int(editing_value_buf, sizeof(editing_value_buf), menu->editing_item->input.editing_value);
                         if (strcmp(editing_value_buf, menu->editing_item->input.rendered_value_str) != 0) {
-                            menu_refresh_single_item_fast(menu->editing_item, true);
+                            refresh = menu->editing_item;
                         }
                         break;
                     case MENU_ITEM_TYPE_SWITCH:
@@ -1122,7 +1664,7 @@ static void menu_state_machine_func(void *v1, void *v2, void *v3)
                         }
 
                         if (strcmp(current_str, menu->editing_item->switch_ctrl.rendered_value_str) != 0) {
-                            menu_refresh_single_item_fast(menu->editing_item, true);
+                            refresh = menu->editing_item;
                         }
                         break;
                     default:
@@ -1133,10 +1675,18 @@ static void menu_state_machine_func(void *v1, void *v2, void *v3)
                 // The editing item refresh is handled in the block above.
                 // We no longer need to refresh non-editing INPUT items based on live value changes.
             }
+            if (refresh) {
+                menu_view_take(menu);
+            }
             k_mutex_unlock(&menu->state_mutex);
+
+            if (refresh) {
+                menu_refresh_single_item_fast(refresh, true);
+            }
         }
         events[0].state = K_POLL_STATE_NOT_READY;
         events[1].state = K_POLL_STATE_NOT_READY;
+        events[2].state = K_POLL_STATE_NOT_READY;
     }
 }
 
@@ -1166,6 +1716,11 @@ struct menu_item_t *menu_get_current_item(struct menu_t *menu)
 
 INPUT_CALLBACK_DEFINE_NAMED(DEVICE_DT_GET(DT_NODELABEL(buttons)), menu_input_key_cb, &local_menu, key);
 
+#ifdef CONFIG_MENU_STATIC_ALLOC
+static struct menu_group_t menu_group_pool[CONFIG_MENU_MAX_GROUPS];
+static uint8_t menu_group_count;
+#endif
+
 static char g_update_msgq_buffer[MENU_UPDATE_MSGQ_MAX_MSGS * sizeof(struct menu_update_msg)];
 
 struct menu_t *menu_create(const struct device *render_dev)
@@ -1177,7 +1732,6 @@ struct menu_t *menu_create(const struct device *render_dev)
     menu->pannel = pannel_create(render_dev);
     if (!menu->pannel)
     {
-        k_free(menu);
         return NULL;
     }
 
@@ -1185,9 +1739,8 @@ struct menu_t *menu_create(const struct device *render_dev)
     k_mutex_init(&menu->pannel_mutex);
     k_mutex_init(&menu->state_mutex);
     k_msgq_init(&menu->update_msgq, g_update_msgq_buffer, sizeof(struct menu_update_msg), MENU_UPDATE_MSGQ_MAX_MSGS);
+    k_poll_signal_init(&menu->input_signal);
     
-    k_timer_init(&menu->label_refresh_timer, label_refresh_timer_cb, NULL);
-    k_work_init(&menu->label_refresh_work, label_refresh_work_handler);
 
     menu->group_stack_top = -1;
     menu->group_to_refresh = NULL;
@@ -1246,6 +1799,7 @@ void menu_disable_qdec(struct menu_t *menu, bool disable)
 
     if (disable) {
         sensor_trigger_set(menu->qdec_dev, &menu->trigger, NULL);
+        atomic_set(&menu->qdec_steps, 0);
     } else {
         sensor_trigger_set(menu->qdec_dev, &menu->trigger, menu_state_qdec_cb);
     }
@@ -1261,7 +1815,7 @@ int menu_item_add(struct menu_t *menu, struct menu_item_t *item, uint8_t parent)
         return -EINVAL;
     }
 
-    if (menu->item && find_menu_item_by_id(menu->item, item->id)) {
+    if (menu->item_by_id[item->id]) {
         return -EEXIST;
     }
 
@@ -1275,20 +1829,21 @@ int menu_item_add(struct menu_t *menu, struct menu_item_t *item, uint8_t parent)
 
     if (!menu->item) {
         menu->item = item;
+        menu->item_tail = item;
+        menu->item_by_id[item->id] = item;
         return 0;
     }
 
     struct menu_item_t *parent_item = NULL;
-    if (parent == 0) {
-        parent_item = NULL;
-    } else {
-        struct menu_item_t *current = menu->item;
-        parent_item = find_menu_item_by_id(current, parent);
+    if (parent != 0) {
+        parent_item = menu->item_by_id[parent];
         if (!parent_item) {
             return -ENOENT;
         }
     }
 
+    menu->item_by_id[item->id] = item;
+
     item->parent = parent_item;
 
     if (parent_item) {
@@ -1303,50 +1858,21 @@ int menu_item_add(struct menu_t *menu, struct menu_item_t *item, uint8_t parent)
             item->prev = child; 
         }
     } else {
-        struct menu_item_t *current = menu->item;
-        while (current->next) {
-            current = current->next;
-        }
-        current->next = item;
-        item->prev = current;
+        menu->item_tail->next = item;
+        item->prev = menu->item_tail;
+        menu->item_tail = item;
     }
 
     return 0;
 }
 
-static struct menu_item_t *find_menu_item_by_id(struct menu_item_t *root, uint8_t id)
+struct menu_item_t *menu_item_find(struct menu_t *menu, uint8_t id)
 {
-    if (!root) {
+    if (!menu) {
         return NULL;
     }
 
-    struct menu_item_t *current = root;
-
-    while (current) {
-        if (current->id == id) {
-            return current;
-        }
-        
-        if (current->items) {
-            current = current->items;
-        }
-
-        else if (current->next) {
-            current = current->next;
-        }
-        else {
-
-            while (current && !current->next) {
-                current = current->parent;
-            }
-
-            if (current) {
-                current = current->next;
-            }
-        }
-    }
-    
-    return NULL;
+    return menu->item_by_id[id];
 }
 
 void menu_render_start(struct menu_t *menu)
@@ -1361,10 +1887,20 @@ void menu_render_start(struct menu_t *menu)
 
 struct menu_group_t *menu_group_create(struct menu_t *menu, const char *title, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t color, uint32_t align, uint32_t item_text_align)
 {
-    struct menu_group_t *group = k_malloc(sizeof(struct menu_group_t));
+    struct menu_group_t *group;
+
+#ifdef CONFIG_MENU_STATIC_ALLOC
+    if (menu_group_count >= ARRAY_SIZE(menu_group_pool)) {
+        LOG_ERR("menu group pool exhausted");
+        return NULL;
+    }
+    group = &menu_group_pool[menu_group_count++];
+#else
+    group = k_malloc(sizeof(struct menu_group_t));
     if (!group) {
         return NULL;
     }
+#endif
 
     strncpy(group->title, title, sizeof(group->title) - 1);
     group->title[sizeof(group->title) - 1] = '\0';
@@ -1380,6 +1916,8 @@ struct menu_group_t *menu_group_create(struct menu_t *menu, const char *title, u
     group->always_visible = false;
     group->align = align;
     group->item_text_align = item_text_align;
+    group->style = 0;
+    group->layout_valid = false;
     group->menu = menu;
 
     if (!menu->groups) {
@@ -1397,17 +1935,27 @@ struct menu_group_t *menu_group_create(struct menu_t *menu, const char *title, u
 
 int menu_group_add_item(struct menu_group_t *group, struct menu_item_t *item)
 {
+    int ret;
+
     if (!group || !item) {
         return -EINVAL;
     }
 
-    item->group = group;
-    item->menu = group->menu;
+    if (item->type == MENU_ITEM_TYPE_PLOT && (!item->plot.samples || !item->plot.width)) {
+        return -EINVAL;
+    }
 
-    if (group->menu && item->type != MENU_ITEM_TYPE_LABEL) {
-        menu_item_add(group->menu, item, 0);
+    /* read-only items are not navigable */
+    if (group->menu && menu_item_navigable(item)) {
+        ret = menu_item_add(group->menu, item, 0);
+        if (ret) {
+            return ret;
+        }
     }
 
+    item->group = group;
+    item->menu = group->menu;
+
     if (!group->items) {
         group->items = item;
         item->group_prev = NULL;
@@ -1420,14 +1968,16 @@ int menu_group_add_item(struct menu_group_t *group, struct menu_item_t *item)
         item->group_prev = current;
     }
     item->group_next = NULL;
+    menu_group_layout_invalidate(group);
 
     return 0;
 }
 
 void menu_item_set_visible(struct menu_item_t *item, bool visible)
 {
-    if (item) {
+    if (item && item->visible != visible) {
         item->visible = visible;
+        menu_group_layout_invalidate(item->group);
     }
 }
 
@@ -1440,8 +1990,18 @@ void menu_group_set_visible(struct menu_group_t *group, bool visible)
 
 void menu_group_bind_item(struct menu_group_t *group, struct menu_item_t *item)
 {
-    if (group) {
-        group->bind_item = item;
+    if (!group) {
+        return;
+    }
+
+    if (group->menu && group->bind_item && group->menu->group_by_item[group->bind_item->id] == group) {
+        group->menu->group_by_item[group->bind_item->id] = NULL;
+    }
+
+    group->bind_item = item;
+
+    if (group->menu && item) {
+        group->menu->group_by_item[item->id] = group;
     }
 }
 
@@ -1490,12 +2050,11 @@ static struct menu_group_t *find_group_by_bind_item(struct menu_t *menu, struct
         return NULL;
     }
 
-    struct menu_group_t *group = menu->groups;
-    while (group) {
-        if (group->bind_item == item) {
-            return group;
-        }
-        group = group->next;
+    struct menu_group_t *group = menu->group_by_item[item->id];
+
+    /* labels are not registered, their ids may alias a real item */
+    if (group && group->bind_item == item) {
+        return group;
     }
 
     return NULL;
@@ -1505,6 +2064,7 @@ void menu_group_set_align(struct menu_group_t *group, uint32_t align)
 {
     if (group) {
         group->align = align;
+        menu_group_layout_invalidate(group);
     }
 }
 
@@ -1515,31 +2075,18 @@ void menu_group_set_item_text_align(struct menu_group_t *group, uint32_t align)
     }
 }
 
-void menu_set_main_group(struct menu_t *menu, struct menu_group_t *group)
+void menu_group_set_style(struct menu_group_t *group, uint32_t style)
 {
-    if (menu) {
-        menu->main_group = group;
+    if (group) {
+        group->style = style;
     }
 }
 
-static void menu_refresh_item_selection(struct menu_t *menu, struct menu_item_t *last_item, struct menu_item_t *current_item)
+void menu_set_main_group(struct menu_t *menu, struct menu_group_t *group)
 {
-    if (!menu || !last_item || !current_item || !last_item->group || last_item->group != current_item->group) {
-        return;
+    if (menu) {
+        menu->main_group = group;
     }
-
-    struct menu_group_t *group = current_item->group;
-
-    k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-
-    uint16_t item_x, last_y, current_y, item_w;
-    menu_get_item_layout(group, last_item, &item_x, &last_y, &item_w);
-    menu_get_item_layout(group, current_item, &item_x, &current_y, &item_w);
-
-    menu_render_item(menu, last_item, item_x, last_y, false, item_w);
-    menu_render_item(menu, current_item, item_x, current_y, true, item_w);
-
-    k_mutex_unlock(&menu->pannel_mutex);
 }
 
 static void menu_render_item_value_only(struct menu_item_t *item)
@@ -1550,32 +2097,15 @@ static void menu_render_item_value_only(struct menu_item_t *item)
 
 	struct menu_t *menu = item->menu;
 
-	k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
+	menu_pannel_lock(menu);
 
 	uint16_t item_x, item_y, item_w;
 	menu_get_item_layout(item->group, item, &item_x, &item_y, &item_w);
 
-	bool selected = (item == menu->current_item);
+	bool selected = (item == menu->view.current_item);
 	menu_render_item(menu, item, item_x, item_y, selected, item_w);
 
-	k_mutex_unlock(&menu->pannel_mutex);
-}
-
-static void menu_refresh_single_item(struct menu_t *menu, struct menu_item_t *item)
-{
-    if (!menu || !item || !item->group || !item->group->visible) {
-        return;
-    }
-
-    k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-
-    uint16_t item_x, item_y, item_w;
-    menu_get_item_layout(item->group, item, &item_x, &item_y, &item_w);
-
-    bool selected = (item == menu->current_item);
-    menu_render_item(menu, item, item_x, item_y, selected, item_w);
-
-    k_mutex_unlock(&menu->pannel_mutex);
+	menu_pannel_unlock(menu);
 }
 
 static void menu_refresh_single_item_fast(struct menu_item_t *item, bool selected)
@@ -1591,14 +2121,14 @@ static void menu_refresh_single_item_fast(struct menu_item_t *item, bool selecte
         const char *old_value_str;
 
         if (item->type == MENU_ITEM_TYPE_SWITCH) {
-            bool is_on = (menu->editing_item == item) ? item->switch_ctrl.editing_is_on : item->switch_ctrl.is_on;
+            bool is_on = (menu->view.editing_item == item) ? item->switch_ctrl.editing_is_on : item->switch_ctrl.is_on;
             const char * text = is_on ? (item->switch_ctrl.text_on ? item->switch_ctrl.text_on : "ON")
                                      : (item->switch_ctrl.text_off ? item->switch_ctrl.text_off : "OFF");
             strncpy(new_value_buf, text, sizeof(new_value_buf) - 1);
             old_value_str = item->switch_ctrl.rendered_value_str;
         } else { // INPUT
-            int32_t value_to_display = (menu->editing_item == item) ? item->input.editing_value : item->input.value;
-            snprintf(new_value_buf, sizeof(new_value_buf), "%d", value_to_display);
+            int32_t value_to_display = (menu->view.editing_item == item) ? item->input.editing_value : item->input.value;
+            text_int(new_value_buf, sizeof(new_value_buf), value_to_display);
             old_value_str = item->input.rendered_value_str;
         }
 
@@ -1617,65 +2147,76 @@ static void menu_refresh_single_item_fast(struct menu_item_t *item, bool selecte
         uint16_t bg_color = selected ? COLOR_WHITE : COLOR_BLACK;
         uint16_t text_color = selected ? COLOR_BLACK : COLOR_WHITE;
 
-        k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
+        menu_pannel_lock(menu);
 
-        uint16_t old_value_width = strlen(old_value_str) * CONFIG_FONT_WIDTH;
-        if (old_value_width > 0) {
-             pannel_render_rect(menu->pannel, value_x, text_y, old_value_width, CONFIG_FONT_HEIGHT, bg_color, true);
-        }
-
-        pannel_render_txt(menu->pannel, (uint8_t *)new_value_buf, value_x, text_y, text_color);
+        /* same length as the old value, the glyph cells cover it */
+        pannel_render_txt_bg(menu->pannel, (uint8_t *)new_value_buf, value_x, text_y, text_color, bg_color);
 
-        k_mutex_unlock(&menu->pannel_mutex);
+        menu_pannel_unlock(menu);
         return; 
     }
 
 full_refresh:
-    k_mutex_lock(&item->menu->pannel_mutex, K_FOREVER);
+    menu_pannel_lock(item->menu);
     uint16_t item_x, item_y, item_w;
     menu_get_item_layout(item->group, item, &item_x, &item_y, &item_w);
     menu_render_item(item->menu, item, item_x, item_y, selected, item_w);
-    k_mutex_unlock(&item->menu->pannel_mutex);
+    menu_pannel_unlock(item->menu);
 }
 
 
 static void menu_get_item_layout(struct menu_group_t *group, struct menu_item_t *item_to_find, uint16_t *out_x, uint16_t *out_y, uint16_t *out_w)
 {
-    if (!group || !item_to_find || !out_x || !out_y || !out_w) {
+    if (!group || !item_to_find || !out_x || !out_y || !out_w || !item_to_find->visible) {
         return;
     }
 
-    uint16_t total_height = 0;
-    struct menu_item_t *item = group->items;
-    int visible_items = 0;
-    while (item) {
-        if (item->visible) {
-            visible_items++;
-        }
-        item = item->group_next;
-    }
-    total_height = visible_items * (CONFIG_FONT_HEIGHT + 5);
+    menu_group_layout(group);
 
-    uint16_t start_x = group->x + 5;
-    uint16_t start_y = group->y + 5;
-    if (group->align & MENU_ALIGN_V_CENTER) {
-        start_y = group->y + (group->height - total_height) / 2;
-    }
+    *out_x = group->x + 5;
+    *out_y = item_to_find->layout_y;
+    *out_w = group->width - 10;
+}
 
-    item = group->items;
-    uint16_t current_y = start_y;
-    while (item) {
-        if (item->visible) {
-            if (item == item_to_find) {
-                *out_x = start_x;
-                *out_y = current_y;
-                *out_w = group->width - 10;
-                return;
-            }
-            current_y += CONFIG_FONT_HEIGHT + 5;
-        }
-        item = item->group_next;
-    }
+/* number of characters "%d" prints for value */
+static uint8_t menu_int_len(int32_t value)
+{
+	uint32_t u = value < 0 ? -(uint32_t)value : (uint32_t)value;
+	uint8_t len = value < 0 ? 2 : 1;
+
+	while (u >= 10) {
+		u /= 10;
+		len++;
+	}
+
+	return len;
+}
+
+static uint16_t menu_item_fit_width(struct menu_t *menu, struct menu_item_t *item)
+{
+	uint16_t width = CONFIG_FONT_WIDTH * strlen((const char *)item->name);
+
+	if (item->type == MENU_ITEM_TYPE_PLOT) {
+		return item->plot.width;
+	}
+
+	/* meters span the group so the delta strips line up with any alignment */
+	if ((item->type == MENU_ITEM_TYPE_BAR || item->type == MENU_ITEM_TYPE_GAUGE) && item->group) {
+		return item->group->width - 10;
+	}
+
+	if (item->type == MENU_ITEM_TYPE_INPUT) {
+		int32_t value = (menu->view.editing_item == item) ? item->input.editing_value : item->input.value;
+		width += 5 + menu_int_len(value) * CONFIG_FONT_WIDTH;
+	} else if (item->type == MENU_ITEM_TYPE_SWITCH) {
+		width += 5 + strlen("OFF") * CONFIG_FONT_WIDTH;
+	} else if (item->type == MENU_ITEM_TYPE_LABEL && item->label_cb) {
+		char label_buf[32] = {0};
+		item->label_cb(item, label_buf, sizeof(label_buf));
+		width += 1 + strlen(label_buf) * CONFIG_FONT_WIDTH;
+	}
+
+	return width;
 }
 
 void menu_item_refresh(struct menu_item_t *item)
@@ -1687,60 +2228,39 @@ void menu_item_refresh(struct menu_item_t *item)
 	struct menu_t *menu = item->menu;
 	struct menu_group_t *group = item->group;
 
-	k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
+	menu_pannel_lock(menu);
 
 	pannel_render_rect(menu->pannel, group->x + 1, group->y + 4, group->width - 2, group->height - 5, COLOR_BLACK, true);
+	/* the clear reaches into rounded corners */
+	if (group->style & MENU_STYLE_ROUND_CORNER) {
+		menu_render_group_chrome(menu, group);
+	}
 
 	uint16_t max_item_width = 0;
-	uint16_t total_height = 0;
-	struct menu_item_t *current_item_in_loop = group->items;
-	while (current_item_in_loop) {
+	struct menu_item_t *current_item_in_loop;
+	for (current_item_in_loop = group->items; current_item_in_loop; current_item_in_loop = current_item_in_loop->group_next) {
 		if (current_item_in_loop->visible) {
-			size_t name_len = strlen((const char *)current_item_in_loop->name);
-			uint16_t current_item_width = CONFIG_FONT_WIDTH * name_len;
-			if (current_item_in_loop->type == MENU_ITEM_TYPE_INPUT) {
-				char value_buf[16] = {0};
-				int32_t value_to_display = (menu->editing_item == current_item_in_loop) ? current_item_in_loop->input.editing_value : current_item_in_loop->input.value;
-				snprintf(value_buf, sizeof(value_buf), "%d", value_to_display);
-				current_item_width += 5 + strlen(value_buf) * CONFIG_FONT_WIDTH;
-            } else if (current_item_in_loop->type == MENU_ITEM_TYPE_SWITCH) {
-                current_item_width += 5 + strlen("OFF") * CONFIG_FONT_WIDTH;
-            } else if (current_item_in_loop->type == MENU_ITEM_TYPE_LABEL && current_item_in_loop->label_cb) {
-    char label_buf[32] = {0};
-    current_item_in_loop->label_cb(current_item_in_loop, label_buf, sizeof(label_buf));
-    current_item_width += 1 + strlen(label_buf) * CONFIG_FONT_WIDTH;
-			}
-			if (current_item_width > max_item_width) {
-				max_item_width = current_item_width;
-			}
-			total_height += CONFIG_FONT_HEIGHT + 5;
+			max_item_width = MAX(max_item_width, menu_item_fit_width(menu, current_item_in_loop));
 		}
-		current_item_in_loop = current_item_in_loop->group_next;
 	}
 
+	menu_group_layout(group);
+
 	uint16_t start_x = group->x + 5;
-	uint16_t start_y = group->y + 5;
-	if (group->align & MENU_ALIGN_V_CENTER) {
-		start_y = group->y + (group->height - total_height) / 2;
-	}
 	if (group->item_text_align & MENU_STYLE_CENTER) {
 		start_x = group->x + (group->width - max_item_width) / 2;
 	} else if (group->item_text_align & MENU_STYLE_RIGHT) {
 		start_x = group->x + group->width - max_item_width - 5;
 	}
 
-	current_item_in_loop = group->items;
-	uint16_t current_y = start_y;
-	while (current_item_in_loop) {
+	for (current_item_in_loop = group->items; current_item_in_loop; current_item_in_loop = current_item_in_loop->group_next) {
 		if (current_item_in_loop->visible) {
-			bool selected = (current_item_in_loop == menu->current_item);
-			menu_render_item(menu, current_item_in_loop, start_x, current_y, selected, max_item_width);
-			current_y += CONFIG_FONT_HEIGHT + 5;
+			bool selected = (current_item_in_loop == menu->view.current_item);
+			menu_render_item(menu, current_item_in_loop, start_x, current_item_in_loop->layout_y, selected, max_item_width);
 		}
-		current_item_in_loop = current_item_in_loop->group_next;
 	}
 
-	k_mutex_unlock(&menu->pannel_mutex);
+	menu_pannel_unlock(menu);
 }
 
 bool menu_item_is_editing(struct menu_item_t *item)
@@ -1764,9 +2284,9 @@ void *menu_driver_get(struct menu_t *menu)
     return menu->driver;
 }
 
-static void menu_render_dialog(struct menu_t *menu, struct menu_item_t *item)
+static void menu_render_dialog(struct menu_t *menu, const struct item_dialog_t *dialog)
 {
-   if (!menu || !item) {
+   if (!menu || !dialog) {
        return;
    }
 
@@ -1781,20 +2301,20 @@ static void menu_render_dialog(struct menu_t *menu, struct menu_item_t *item)
    pannel_render_rect(menu->pannel, box_x, box_y, box_w, box_h, COLOR_WHITE, false);
    pannel_render_rect(menu->pannel, box_x + 1, box_y + 1, box_w - 2, box_h - 2, COLOR_BLACK, true);
 
-   if (item->dialog.title[0] != '\0') {
-       uint16_t title_len = strlen(item->dialog.title);
+   if (dialog->title[0] != '\0') {
+       uint16_t title_len = strlen(dialog->title);
        uint16_t title_width = title_len * CONFIG_FONT_WIDTH;
        uint16_t title_x = box_x + (box_w - title_width) / 2;
-       pannel_render_txt(menu->pannel, (uint8_t *)item->dialog.title, title_x, box_y + 5, COLOR_YELLOW);
+       pannel_render_txt_bg(menu->pannel, (uint8_t *)dialog->title, title_x, box_y + 5, COLOR_YELLOW, COLOR_BLACK);
    }
 
-   uint16_t msg_len = strlen(item->dialog.msg);
+   uint16_t msg_len = strlen(dialog->msg);
    uint16_t msg_width = msg_len * CONFIG_FONT_WIDTH;
    uint16_t msg_x = box_x + (box_w - msg_width) / 2;
-   pannel_render_txt(menu->pannel, (uint8_t *)item->dialog.msg, msg_x, box_y + 20, COLOR_WHITE);
+   pannel_render_txt_bg(menu->pannel, (uint8_t *)dialog->msg, msg_x, box_y + 20, COLOR_WHITE, COLOR_BLACK);
 
    uint16_t btn_y = box_y + box_h - CONFIG_FONT_HEIGHT - 10;
-   if (item->dialog.style == DIALOG_STYLE_CONFIRM) {
+   if (dialog->style == DIALOG_STYLE_CONFIRM) {
        const char *ok_text = "OK";
        const char *cancel_text = "Cancel";
        uint16_t ok_width = strlen(ok_text) * CONFIG_FONT_WIDTH + 8;
@@ -1802,19 +2322,21 @@ static void menu_render_dialog(struct menu_t *menu, struct menu_item_t *item)
        uint16_t total_width = ok_width + cancel_width + 20; // 20 for spacing
        uint16_t start_x = box_x + (box_w - total_width) / 2;
 
-       pannel_render_rect(menu->pannel, start_x, btn_y, cancel_width, CONFIG_FONT_HEIGHT + 4, menu->dialog_selected_button == 1 ? COLOR_WHITE : COLOR_BLACK, true);
-       pannel_render_txt(menu->pannel, (uint8_t *)cancel_text, start_x + 4, btn_y + 2, menu->dialog_selected_button == 1 ? COLOR_BLACK : COLOR_WHITE);
+       pannel_render_rect(menu->pannel, start_x, btn_y, cancel_width, CONFIG_FONT_HEIGHT + 4, menu->view.dialog_selected_button == 1 ? COLOR_WHITE : COLOR_BLACK, true);
+       pannel_render_txt_bg(menu->pannel, (uint8_t *)cancel_text, start_x + 4, btn_y + 2, menu->view.dialog_selected_button == 1 ? COLOR_BLACK : COLOR_WHITE,
+                            menu->view.dialog_selected_button == 1 ? COLOR_WHITE : COLOR_BLACK);
 
        start_x += cancel_width + 20;
-       pannel_render_rect(menu->pannel, start_x, btn_y, ok_width, CONFIG_FONT_HEIGHT + 4, menu->dialog_selected_button == 0 ? COLOR_WHITE : COLOR_BLACK, true);
-       pannel_render_txt(menu->pannel, (uint8_t *)ok_text, start_x + 4, btn_y + 2, menu->dialog_selected_button == 0 ? COLOR_BLACK : COLOR_WHITE);
+       pannel_render_rect(menu->pannel, start_x, btn_y, ok_width, CONFIG_FONT_HEIGHT + 4, menu->view.dialog_selected_button == 0 ? COLOR_WHITE : COLOR_BLACK, true);
+       pannel_render_txt_bg(menu->pannel, (uint8_t *)ok_text, start_x + 4, btn_y + 2, menu->view.dialog_selected_button == 0 ? COLOR_BLACK : COLOR_WHITE,
+                            menu->view.dialog_selected_button == 0 ? COLOR_WHITE : COLOR_BLACK);
 
    } else { 
        const char *ok_text = "OK";
        uint16_t btn_width = strlen(ok_text) * CONFIG_FONT_WIDTH + 8;
        uint16_t btn_x = box_x + (box_w - btn_width) / 2;
        pannel_render_rect(menu->pannel, btn_x, btn_y, btn_width, CONFIG_FONT_HEIGHT + 4, COLOR_WHITE, true);
-       pannel_render_txt(menu->pannel, (uint8_t *)ok_text, btn_x + 4, btn_y + 2, COLOR_BLACK);
+       pannel_render_txt_bg(menu->pannel, (uint8_t *)ok_text, btn_x + 4, btn_y + 2, COLOR_BLACK, COLOR_WHITE);
    }
 }
 
@@ -1850,30 +2372,8 @@ static void menu_process_dialog_input(struct menu_t *menu, menu_input_event_t *e
           if (new_selection != old_selection) {
               menu->dialog_selected_button = new_selection;
 
-              k_mutex_lock(&menu->pannel_mutex, K_FOREVER);
-
-              struct display_capabilities *caps;
-              pannel_get_capabilities(menu->pannel, &caps);
-              uint16_t box_w = caps->x_resolution * 0.8;
-              uint16_t box_h = caps->y_resolution * 0.6;
-              uint16_t box_x = (caps->x_resolution - box_w) / 2;
-              uint16_t box_y = (caps->y_resolution - box_h) / 2;
-              uint16_t btn_y = box_y + box_h - CONFIG_FONT_HEIGHT - 10;
-              const char *ok_text = "OK";
-              const char *cancel_text = "Cancel";
-              uint16_t ok_width = strlen(ok_text) * CONFIG_FONT_WIDTH + 8;
-              uint16_t cancel_width = strlen(cancel_text) * CONFIG_FONT_WIDTH + 8;
-              uint16_t total_width = ok_width + cancel_width + 20;
-              uint16_t cancel_x = box_x + (box_w - total_width) / 2;
-              uint16_t ok_x = cancel_x + cancel_width + 20;
-
-              pannel_render_rect(menu->pannel, cancel_x, btn_y, cancel_width, CONFIG_FONT_HEIGHT + 4, (new_selection == 1) ? COLOR_WHITE : COLOR_BLACK, true);
-              pannel_render_txt(menu->pannel, (uint8_t *)cancel_text, cancel_x + 4, btn_y + 2, (new_selection == 1) ? COLOR_BLACK : COLOR_WHITE);
-
-              pannel_render_rect(menu->pannel, ok_x, btn_y, ok_width, CONFIG_FONT_HEIGHT + 4, (new_selection == 0) ? COLOR_WHITE : COLOR_BLACK, true);
-              pannel_render_txt(menu->pannel, (uint8_t *)ok_text, ok_x + 4, btn_y + 2, (new_selection == 0) ? COLOR_BLACK : COLOR_WHITE);
-
-              k_mutex_unlock(&menu->pannel_mutex);
+              menu_damage_dialog_buttons(menu);
+              k_sem_give(&menu->render_sem);
           }
       }
       break;
@@ -1897,10 +2397,13 @@ static void menu_process_dialog_input(struct menu_t *menu, menu_input_event_t *e
    }
 
    if (close_dialog) {
+       /* closed first, the callback may show the next dialog */
+       menu->dialog_item = NULL;
        if (dialog->dialog.cb) {
+           k_mutex_unlock(&menu->state_mutex);
            dialog->dialog.cb(dialog, confirmed);
+           k_mutex_lock(&menu->state_mutex, K_FOREVER);
        }
-       menu->dialog_item = NULL;
        menu->needs_render = true;
        k_sem_give(&menu->render_sem);
    }
@@ -1,8 +1,9 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/display.h>
 #include <zephyr/cache.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/sys/byteorder.h>
 #include <string.h>
-#include <math.h>
 #include <stdlib.h>
 
 #include <pannel.h>
@@ -14,70 +15,334 @@
 #include <font_16x16.h>
 #endif
 
+#ifdef CONFIG_DISPLAY_SIM
+#include <sim/display_sim.h>
+#endif
+
+/* without a font there is no text, the glyph buffer still needs a size */
+#ifndef CONFIG_FONT_SIZE
+#define CONFIG_FONT_SIZE 16
+#endif
+
+/*
+ * Primitives rasterize into a surface in the native pixel format and
+ * pannel_flush() sends the result with one display_write per band.
+ *
+ * MENU_RENDER_FRAMEBUFFER keeps the whole screen in RAM and draws at once,
+ * the flush sends each dirty rectangle.
+ * MENU_RENDER_STRIP records the primitives instead and replays them into a
+ * small band buffer at flush time, a band at a time, over the areas that
+ * fills, opaque text, buffers and images cover completely. Lines, outlines
+ * and plain text with nothing opaque recorded under them are written to the
+ * display span by span, on top of what it already shows.
+ *
+ * Opaque text is blitted from a small LRU cache of glyphs already expanded
+ * to pixels for a given foreground and background color.
+ *
+ * With MENU_RENDER_ASYNC the transfers run on a flush thread, the caller of
+ * pannel_flush() does not wait for the bus.
+ */
+
+enum pannel_cmd_type {
+    PANNEL_CMD_FILL,
+    PANNEL_CMD_RECT,
+    PANNEL_CMD_LINE,
+    PANNEL_CMD_ROUND_RECT,
+    PANNEL_CMD_ROUND_FILL,
+    PANNEL_CMD_TEXT,
+    PANNEL_CMD_TEXT_BG,
+    PANNEL_CMD_BUFFER,
+    PANNEL_CMD_IMAGE,
+};
+
+struct pannel_area {
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;
+    int16_t y1;
+};
+
+/*
+ * x/y is the origin, w/h the size or the line end point, r the corner radius.
+ * area holds the clipped bounds, direct is set when nothing opaque recorded
+ * before lies under them.
+ */
+struct pannel_cmd {
+    uint8_t type;
+    bool direct;
+    uint16_t size;
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+    int16_t r;
+    struct pannel_area area;
+    uint32_t color;
+    uint32_t bg;
+    const void *data;
+};
+
+/* rasterizer target, buf holds the screen area at x/y of w x h */
+struct pannel_surface {
+    uint8_t *buf;
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+    uint16_t pitch;
+#ifdef CONFIG_MENU_RENDER_STRIP
+    /* no buf, every span goes straight to the display */
+    bool direct;
+#endif
+};
+
+/* pixel writers of one format, picked once by pannel_create() */
+struct pannel_pixel_ops {
+    uint8_t bpp;
+    void (*store)(uint8_t *dst, uint32_t color);
+    void (*fill)(uint8_t *dst, uint32_t color, size_t n);
+};
+
+struct pannel_glyph {
+    char c;
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t used;
+    uint8_t *pixels;
+};
+
+#define PANNEL_DIRTY_MAX 8
+#define PANNEL_AREAS_MAX 8
+
+/* what one flush sends, in strip mode along with the recorded primitives */
+struct pannel_batch {
+#ifdef CONFIG_MENU_RENDER_FRAMEBUFFER
+    struct pannel_rect dirty[PANNEL_DIRTY_MAX];
+    uint8_t dirty_count;
+#else
+    uint8_t *cmds;
+    size_t used;
+    /* areas opaque primitives cover completely, composed in the band buffer */
+    struct pannel_area areas[PANNEL_AREAS_MAX];
+    uint8_t area_count;
+#endif
+};
+
+#if defined(CONFIG_MENU_RENDER_ASYNC) && defined(CONFIG_MENU_RENDER_STRIP)
+#define PANNEL_BATCHES 2
+#else
+#define PANNEL_BATCHES 1
+#endif
+
+#define PANNEL_FLUSH_STACK_SIZE 1024
+#define PANNEL_FLUSH_PRIORITY   6
+
 struct pannel_t {
     const struct device *render_dev;
+    const struct pannel_pixel_ops *ops;
     uint8_t bytes_per_pixel;
     struct display_capabilities caps;
     uint8_t font_size;
     void *buf;
-    uint16_t buf_size;
+    size_t buf_size;
+    struct pannel_area clip;
+    /* one unused slot when the cache is disabled, glyph_count stays 0 */
+    struct pannel_glyph glyphs[MAX(CONFIG_MENU_GLYPH_CACHE_SIZE, 1)];
+    uint8_t glyph_count;
+    uint32_t glyph_clock;
+    struct pannel_batch batches[PANNEL_BATCHES];
+    struct pannel_batch *batch;
+#ifdef CONFIG_MENU_RENDER_STRIP
+    size_t cmds_size;
+#endif
+#ifdef CONFIG_MENU_RENDER_ASYNC
+    struct k_msgq flush_q;
+    struct pannel_batch *flush_q_buf[PANNEL_BATCHES];
+    struct k_sem flush_free;
+    struct k_thread flush_thread;
+    K_KERNEL_STACK_MEMBER(flush_stack, PANNEL_FLUSH_STACK_SIZE);
+#endif
 };
 
-static int draw_circle_point(struct pannel_t *pannel, uint16_t x, uint16_t y, uint32_t color)
+#define PANNEL_WIDTH    DT_PROP(DT_CHOSEN(zephyr_display), width)
+#define PANNEL_HEIGHT   DT_PROP(DT_CHOSEN(zephyr_display), height)
+
+#ifdef CONFIG_MENU_RENDER_FRAMEBUFFER
+/* whole screen at up to 2 bytes per pixel */
+#define PANNEL_BUF_SIZE (PANNEL_WIDTH * PANNEL_HEIGHT * 2)
+#else
+/* band buffer, at up to 4 bytes per pixel */
+#define PANNEL_BUF_SIZE (PANNEL_WIDTH * CONFIG_MENU_RENDER_STRIP_LINES * 4)
+#endif
+
+/* glyph slots at 2 bytes per pixel, wider formats get fewer of them */
+#define PANNEL_GLYPH_BUF_SIZE (CONFIG_MENU_GLYPH_CACHE_SIZE * CONFIG_FONT_SIZE * CONFIG_FONT_SIZE * 2)
+
+#ifdef CONFIG_MENU_STATIC_ALLOC
+static struct pannel_t pannel_instance;
+static uint8_t pannel_buf[PANNEL_BUF_SIZE] __aligned(4);
+#if CONFIG_MENU_GLYPH_CACHE_SIZE > 0
+static uint8_t pannel_glyph_buf[PANNEL_GLYPH_BUF_SIZE] __aligned(4);
+#endif
+#ifdef CONFIG_MENU_RENDER_STRIP
+static uint8_t pannel_cmd_buf[PANNEL_BATCHES][CONFIG_MENU_RENDER_CMD_BUF_SIZE] __aligned(4);
+#endif
+#endif
+
+static void pixel_store_8(uint8_t *dst, uint32_t color)
 {
-    struct display_buffer_descriptor desc = {0};
-    uint8_t *buf = pannel->buf;
+    dst[0] = color;
+}
 
-    if (!pannel)
-        return -EINVAL;
+static void pixel_fill_8(uint8_t *dst, uint32_t color, size_t n)
+{
+    memset(dst, color, n);
+}
 
-    if (x >= pannel->caps.x_resolution || y >= pannel->caps.y_resolution)
-        return -EINVAL;
+static void pixel_store_16(uint8_t *dst, uint32_t color)
+{
+    *(uint16_t *)dst = color;
+}
 
-    switch(pannel->bytes_per_pixel)
-    {
-        case 1:
-            buf[0] = color & 0xff;
-            break;
-        case 2:
-            *(uint16_t *)buf = color & 0xffff;
-            break;
-        case 3:
-            buf[0] = (color >> 16) & 0xff;
-            buf[1] = (color >> 8) & 0xff;
-            buf[2] = color & 0xff;
-            break;
-        default:
-            *(uint32_t *)buf = color;
+static void pixel_fill_16(uint8_t *dst, uint32_t color, size_t n)
+{
+    uint32_t word = (color & 0xffff) * 0x10001;
+    uint32_t *w;
 
+    /* rows start on a pixel, get to a word boundary first */
+    if (n && ((uintptr_t)dst & 2)) {
+        *(uint16_t *)dst = color;
+        dst += 2;
+        n--;
     }
 
-    desc.buf_size = pannel->bytes_per_pixel;
-    desc.width = 1;
-    desc.height = 1;
-    desc.pitch = 1;
-    desc.frame_incomplete = false;
+    for (w = (uint32_t *)dst; n >= 2; n -= 2)
+        *w++ = word;
 
-    display_write(pannel->render_dev, x, y, &desc, buf);
+    if (n)
+        *(uint16_t *)w = color;
+}
 
-    return 0;
+static void pixel_store_24(uint8_t *dst, uint32_t color)
+{
+    dst[0] = color >> 16;
+    dst[1] = color >> 8;
+    dst[2] = color;
 }
 
-void pannel_render_line(struct pannel_t *pannel, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color)
+/* one pixel, then the filled part is copied onto the rest, doubling each time */
+static void pixel_fill_24(uint8_t *dst, uint32_t color, size_t n)
+{
+    size_t size = n * 3;
+    size_t done = 3;
+
+    if (!n)
+        return;
+
+    pixel_store_24(dst, color);
+    while (done < size) {
+        size_t len = MIN(done, size - done);
+
+        memcpy(dst + done, dst, len);
+        done += len;
+    }
+}
+
+static void pixel_store_32(uint8_t *dst, uint32_t color)
+{
+    *(uint32_t *)dst = color;
+}
+
+static void pixel_fill_32(uint8_t *dst, uint32_t color, size_t n)
+{
+    uint32_t *w = (uint32_t *)dst;
+
+    while (n--)
+        *w++ = color;
+}
+
+static const struct pannel_pixel_ops pannel_pixel_ops_8 = { 1, pixel_store_8, pixel_fill_8 };
+static const struct pannel_pixel_ops pannel_pixel_ops_16 = { 2, pixel_store_16, pixel_fill_16 };
+static const struct pannel_pixel_ops pannel_pixel_ops_24 = { 3, pixel_store_24, pixel_fill_24 };
+static const struct pannel_pixel_ops pannel_pixel_ops_32 = { 4, pixel_store_32, pixel_fill_32 };
+
+#ifdef CONFIG_MENU_RENDER_STRIP
+static void pannel_write_fill(struct pannel_t *pannel, int x, int y, int w, int h, uint32_t color);
+#endif
+
+static inline void draw_point(struct pannel_t *pannel, struct pannel_surface *s, int x, int y, uint32_t color)
+{
+    x -= s->x;
+    y -= s->y;
+
+    if (x < 0 || y < 0 || x >= s->w || y >= s->h)
+        return;
+
+#ifdef CONFIG_MENU_RENDER_STRIP
+    if (s->direct) {
+        pannel_write_fill(pannel, s->x + x, s->y + y, 1, 1, color);
+        return;
+    }
+#endif
+
+    pannel->ops->store(s->buf + (y * s->pitch + x) * pannel->bytes_per_pixel, color);
+}
+
+static void draw_fill(struct pannel_t *pannel, struct pannel_surface *s, int x, int y, int w, int h, uint32_t color)
+{
+    uint8_t bpp = pannel->bytes_per_pixel;
+    size_t row_size;
+    uint8_t *row;
+    int x1 = MIN(x + w, s->x + s->w);
+    int y1 = MIN(y + h, s->y + s->h);
+
+    x = MAX(x, s->x);
+    y = MAX(y, s->y);
+    if (x >= x1 || y >= y1)
+        return;
+
+#ifdef CONFIG_MENU_RENDER_STRIP
+    if (s->direct) {
+        pannel_write_fill(pannel, x, y, x1 - x, y1 - y, color);
+        return;
+    }
+#endif
+
+    row = s->buf + ((y - s->y) * s->pitch + (x - s->x)) * bpp;
+    row_size = (x1 - x) * bpp;
+
+    pannel->ops->fill(row, color, x1 - x);
+
+    /* the first row is the pattern for the others */
+    for (uint8_t *dst = row + s->pitch * bpp; ++y < y1; dst += s->pitch * bpp)
+        memcpy(dst, row, row_size);
+}
+
+/* a horizontal or vertical run between two points, as one fill */
+static inline void draw_span(struct pannel_t *pannel, struct pannel_surface *s, int x0, int y0, int x1, int y1, uint32_t color)
+{
+    draw_fill(pannel, s, MIN(x0, x1), MIN(y0, y1), abs(x1 - x0) + 1, abs(y1 - y0) + 1, color);
+}
+
+/*
+ * Bresenham, but the points are collected into runs along the major axis
+ * and each run is drawn as one span.
+ */
+static void draw_line(struct pannel_t *pannel, struct pannel_surface *s, int x0, int y0, int x1, int y1, uint32_t color)
 {
     int dx = abs(x1 - x0);
     int dy = abs(y1 - y0);
     int sx = (x0 < x1) ? 1 : -1;
     int sy = (y0 < y1) ? 1 : -1;
     int err = dx - dy;
-    int e2;
+    int run_x = x0;
+    int run_y = y0;
+    int e2, px, py;
 
-    while(true)
+    while (x0 != x1 || y0 != y1)
     {
-        draw_circle_point(pannel, x0, y0, color);
-
-        if (x0 == x1 && y0 == y1)
-            break;
+        px = x0;
+        py = y0;
 
         e2 = 2 * err;
         if (e2 > -dy)
@@ -90,159 +355,856 @@ void pannel_render_line(struct pannel_t *pannel, uint16_t x0, uint16_t y0, uint1
             err += dx;
             y0 += sy;
         }
+
+        if (dx >= dy ? y0 != run_y : x0 != run_x)
+        {
+            draw_span(pannel, s, run_x, run_y, px, py, color);
+            run_x = x0;
+            run_y = y0;
+        }
     }
+
+    draw_span(pannel, s, run_x, run_y, x1, y1, color);
 }
 
-void pannel_render_txt(struct pannel_t *pannel, uint8_t *txt, uint16_t x, uint16_t y, uint16_t color)
+/*
+ * Rectangle of w x h with corners of radius r, a circle when r is half the
+ * size. The midpoint circle is walked over one octant, the points sharing
+ * the same x are a run, which gives a vertical span on the side edges and a
+ * horizontal span on the top and bottom ones, mirrored to all four corners.
+ * Filled, the same runs become the rows between the left and right arcs.
+ */
+static void draw_round_rect(struct pannel_t *pannel, struct pannel_surface *s, int x, int y, int w, int h, int r, uint32_t color, bool fill)
 {
-    if (!pannel || !txt) {
-        return;
+    int x0, y0, x1, y1;
+    int x_pos, y_pos, err;
+    int run_x, run_y, end;
+
+    r = CLAMP(r, 0, (MIN(w, h) - 1) / 2);
+
+    /* corner centers */
+    x0 = x + r;
+    y0 = y + r;
+    x1 = x + w - 1 - r;
+    y1 = y + h - 1 - r;
+
+    if (fill)
+    {
+        draw_fill(pannel, s, x, y0 + 1, w, y1 - y0 - 1, color);
+    }
+    else
+    {
+        draw_fill(pannel, s, x0, y, x1 - x0 + 1, 1, color);
+        draw_fill(pannel, s, x0, y + h - 1, x1 - x0 + 1, 1, color);
+        draw_fill(pannel, s, x, y0, 1, y1 - y0 + 1, color);
+        draw_fill(pannel, s, x + w - 1, y0, 1, y1 - y0 + 1, color);
     }
 
-    uint16_t current_x = x;
-    char c;
-    const uint8_t *font_data;
+    x_pos = r;
+    y_pos = 0;
+    err = 0;
 
-    while (*txt) {
-        c = *txt;
-        if (c < ' ' || c > '~') {
-            c = ' ';
-        }
+    while (x_pos >= y_pos)
+    {
+        run_x = x_pos;
+        run_y = y_pos;
 
-        if (pannel->font_size == 16) {
-            #ifdef CONFIG_FONT_16X16
-            font_data = font_16x16[c - ' '];
-            for (int i = 0; i < 16; i++) {
-                uint8_t byte1 = font_data[i * 2];
-                uint8_t byte2 = font_data[i * 2 + 1];
-                for (int j = 0; j < 8; j++) {
-                    if ((byte1 >> (7 - j)) & 1) {
-                        draw_circle_point(pannel, current_x + j, y + i, color);
-                    }
-                }
-                for (int j = 0; j < 8; j++) {
-                    if ((byte2 >> (7 - j)) & 1) {
-                        draw_circle_point(pannel, current_x + 8 + j, y + i, color);
-                    }
-                }
+        /* the run of y_pos for which x_pos stays the same */
+        do
+        {
+            end = y_pos;
+            if (err <= 0)
+            {
+                y_pos += 1;
+                err += 2 * y_pos + 1;
             }
-            current_x += 16;
-            #endif
-        } else { // Default to 8x8
-            #ifdef CONFIG_FONT_8X8
-            font_data = font_8x8[c - ' '];
-            for (int i = 0; i < 8; i++) {
-                for (int j = 0; j < 8; j++) {
-                    if ((font_data[i] >> (7 - j)) & 1) {
-                        draw_circle_point(pannel, current_x + j, y + i, color);
-                    }
-                }
+            if (err > 0)
+            {
+                x_pos -= 1;
+                err -= 2 * x_pos + 1;
             }
-            current_x += 8;
-            #endif
+        } while (x_pos == run_x && x_pos >= y_pos);
+
+        if (fill)
+        {
+            draw_fill(pannel, s, x0 - run_x, y0 - end, x1 - x0 + 2 * run_x + 1, end - run_y + 1, color);
+            draw_fill(pannel, s, x0 - run_x, y1 + run_y, x1 - x0 + 2 * run_x + 1, end - run_y + 1, color);
+            draw_fill(pannel, s, x0 - end, y0 - run_x, x1 - x0 + 2 * end + 1, 1, color);
+            draw_fill(pannel, s, x0 - end, y1 + run_x, x1 - x0 + 2 * end + 1, 1, color);
+        }
+        else
+        {
+            draw_span(pannel, s, x1 + run_x, y1 + run_y, x1 + run_x, y1 + end, color);
+            draw_span(pannel, s, x0 - run_x, y1 + run_y, x0 - run_x, y1 + end, color);
+            draw_span(pannel, s, x1 + run_x, y0 - run_y, x1 + run_x, y0 - end, color);
+            draw_span(pannel, s, x0 - run_x, y0 - run_y, x0 - run_x, y0 - end, color);
+            draw_span(pannel, s, x1 + run_y, y1 + run_x, x1 + end, y1 + run_x, color);
+            draw_span(pannel, s, x0 - run_y, y1 + run_x, x0 - end, y1 + run_x, color);
+            draw_span(pannel, s, x1 + run_y, y0 - run_x, x1 + end, y0 - run_x, color);
+            draw_span(pannel, s, x0 - run_y, y0 - run_x, x0 - end, y0 - run_x, color);
         }
-        txt++;
     }
 }
 
-void pannel_render_rect(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color, bool fill)
+/* one glyph row, leftmost pixel in the top bit */
+static uint16_t pannel_glyph_row(struct pannel_t *pannel, char c, int row)
 {
-    if (!pannel) {
-        return;
+    const uint8_t *font_data;
+
+    if (pannel->font_size == 16) {
+#ifdef CONFIG_FONT_16X16
+        font_data = font_16x16[c - ' '];
+        return (font_data[row * 2] << 8) | font_data[row * 2 + 1];
+#endif
+    } else {
+#ifdef CONFIG_FONT_8X8
+        font_data = font_8x8[c - ' '];
+        return font_data[row] << 8;
+#endif
     }
 
-    if (fill) {
-        struct display_buffer_descriptor desc;
-        size_t buf_size = w * pannel->bytes_per_pixel;
-        uint8_t *buf = pannel->buf;
-
-        for (size_t i = 0; i < buf_size; i += pannel->bytes_per_pixel) {
-            switch (pannel->bytes_per_pixel) {
-                case 1:
-                    buf[i] = color & 0xFF;
-                    break;
-                case 2:
-                    *(uint16_t *)(buf + i) = color & 0xFFFF;
-                    break;
-                case 3:
-                    buf[i] = (color >> 16) & 0xFF;
-                    buf[i + 1] = (color >> 8) & 0xFF;
-                    buf[i + 2] = color & 0xFF;
-                    break;
-                case 4:
-                    *(uint32_t *)(buf + i) = color;
-                    break;
+    return 0;
+}
+
+static char pannel_glyph_char(char c)
+{
+    return (c < ' ' || c > '~') ? ' ' : c;
+}
+
+static void draw_txt(struct pannel_t *pannel, struct pannel_surface *s, const char *txt, int x, int y, uint32_t color)
+{
+    uint8_t size = pannel->font_size;
+    int i0 = MAX(s->y - y, 0);
+    int i1 = MIN(s->y + s->h - y, size);
+    uint16_t bits;
+    int n;
+    char c;
+
+    /* only the glyph rows inside the surface */
+    if (i0 >= i1)
+        return;
+
+    for (; *txt && x < s->x + s->w; txt++, x += size) {
+        if (x + size <= s->x)
+            continue;
+
+        c = pannel_glyph_char(*txt);
+
+        for (int i = i0; i < i1; i++) {
+            bits = pannel_glyph_row(pannel, c, i);
+
+            for (int j = 0; bits; j++, bits <<= 1) {
+                if (!(bits & 0x8000))
+                    continue;
+
+                /* a run of set pixels is one span */
+                for (n = 1; bits & (0x8000 >> n); n++)
+                    ;
+                draw_fill(pannel, s, x + j, y + i, n, 1, color);
+                j += n - 1;
+                bits <<= n - 1;
             }
         }
+    }
+}
 
-        desc.buf_size = buf_size;
-        desc.width = w;
-        desc.height = 1;
-        desc.pitch = w;
-        desc.frame_incomplete = false;
+/* cached glyph pixels for c in fg on bg, the least recently used slot is reused */
+static const uint8_t *pannel_glyph_get(struct pannel_t *pannel, char c, uint32_t fg, uint32_t bg)
+{
+    struct pannel_glyph *victim = &pannel->glyphs[0];
+    struct pannel_glyph *g;
+    uint8_t bpp = pannel->bytes_per_pixel;
+    uint8_t *dst;
+    uint16_t bits;
 
-        for (uint16_t i = 0; i < h; i++) {
-            sys_cache_data_flush_range(buf, buf_size);
-            display_write(pannel->render_dev, x, y + i, &desc, buf);
+    for (g = pannel->glyphs; g < pannel->glyphs + pannel->glyph_count; g++) {
+        if (g->c == c && g->fg == fg && g->bg == bg) {
+            g->used = ++pannel->glyph_clock;
+            return g->pixels;
         }
-    } else {
-        pannel_render_line(pannel, x, y, x + w - 1, y, color);
-        pannel_render_line(pannel, x, y + h - 1, x + w - 1, y + h - 1, color);
-        pannel_render_line(pannel, x, y, x, y + h - 1, color);
-        pannel_render_line(pannel, x + w - 1, y, x + w - 1, y + h - 1, color);
+        if (g->used < victim->used)
+            victim = g;
+    }
+
+    victim->c = c;
+    victim->fg = fg;
+    victim->bg = bg;
+    victim->used = ++pannel->glyph_clock;
+
+    dst = victim->pixels;
+    for (int i = 0; i < pannel->font_size; i++) {
+        bits = pannel_glyph_row(pannel, c, i);
+        for (int j = 0; j < pannel->font_size; j++, bits <<= 1, dst += bpp)
+            pannel->ops->store(dst, (bits & 0x8000) ? fg : bg);
     }
+
+    return victim->pixels;
 }
 
-void pannel_render_circle(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t radius, uint16_t color)
+static void draw_txt_bg(struct pannel_t *pannel, struct pannel_surface *s, const char *txt, int x, int y, uint32_t fg, uint32_t bg)
 {
-    if (!pannel) {
+    uint8_t size = pannel->font_size;
+    uint8_t bpp = pannel->bytes_per_pixel;
+    int i0 = MAX(s->y - y, 0);
+    int i1 = MIN(s->y + s->h - y, size);
+    const uint8_t *pixels;
+    int j0, j1;
+
+    if (!pannel->glyph_count) {
+        draw_fill(pannel, s, x, y, strlen(txt) * size, size, bg);
+        draw_txt(pannel, s, txt, x, y, fg);
         return;
     }
 
-    int x_pos = radius;
-    int y_pos = 0;
-    int err = 0;
+    if (i0 >= i1)
+        return;
+
+    for (; *txt && x < s->x + s->w; txt++, x += size) {
+        if (x + size <= s->x)
+            continue;
+
+        j0 = MAX(s->x - x, 0);
+        j1 = MIN(s->x + s->w - x, size);
+        pixels = pannel_glyph_get(pannel, pannel_glyph_char(*txt), fg, bg);
+
+        for (int i = i0; i < i1; i++) {
+            memcpy(s->buf + ((y + i - s->y) * s->pitch + (x + j0 - s->x)) * bpp,
+                   pixels + (i * size + j0) * bpp, (j1 - j0) * bpp);
+        }
+    }
+}
+
+static void draw_buffer(struct pannel_t *pannel, struct pannel_surface *s, int x, int y, int w, int h, const uint8_t *buf)
+{
+    uint8_t bpp = pannel->bytes_per_pixel;
+    int x0 = MAX(x, s->x);
+    int y0 = MAX(y, s->y);
+    int x1 = MIN(x + w, s->x + s->w);
+    int y1 = MIN(y + h, s->y + s->h);
+
+    for (int row = y0; row < y1 && x0 < x1; row++) {
+        memcpy(s->buf + ((row - s->y) * s->pitch + (x0 - s->x)) * bpp,
+               buf + ((row - y) * w + (x0 - x)) * bpp, (x1 - x0) * bpp);
+    }
+}
+
+#define PANNEL_IMAGE_RUN     0x80
+#define PANNEL_IMAGE_COUNT   0x7f
+
+/*
+ * Decodes the packets straight into the surface, a run becomes one fill per
+ * row it covers. Packets ending above the surface are stepped over without
+ * looking at their pixels and decoding stops below it.
+ */
+static void draw_image(struct pannel_t *pannel, struct pannel_surface *s, int x, int y, const struct pannel_image *image)
+{
+    const uint8_t *p = image->data;
+    int w = image->width;
+    int first = CLAMP(s->y - y, 0, image->height) * w;
+    int last = CLAMP(s->y + s->h - y, 0, image->height) * w;
+    int pos = 0;
+
+    while (pos < last) {
+        uint8_t head = *p++;
+        int n = (head & PANNEL_IMAGE_COUNT) + 1;
+        bool run = head & PANNEL_IMAGE_RUN;
+
+        if (pos + n <= first) {
+            p += run ? 2 : n * 2;
+            pos += n;
+            continue;
+        }
+
+        while (n > 0) {
+            int col = pos % w;
+            int len = MIN(n, w - col);
+            int row = y + pos / w;
+
+            if (run) {
+                draw_fill(pannel, s, x + col, row, len, 1, sys_get_le16(p));
+            } else {
+                for (int i = 0; i < len; i++, p += 2)
+                    draw_point(pannel, s, x + col + i, row, sys_get_le16(p));
+            }
+
+            pos += len;
+            n -= len;
+        }
+
+        if (run)
+            p += 2;
+    }
+}
+
+static void pannel_cmd_draw(struct pannel_t *pannel, struct pannel_surface *s, const struct pannel_cmd *cmd)
+{
+    switch (cmd->type)
+    {
+        case PANNEL_CMD_FILL:
+            draw_fill(pannel, s, cmd->x, cmd->y, cmd->w, cmd->h, cmd->color);
+            break;
+        case PANNEL_CMD_RECT:
+            draw_fill(pannel, s, cmd->x, cmd->y, cmd->w, 1, cmd->color);
+            draw_fill(pannel, s, cmd->x, cmd->y + cmd->h - 1, cmd->w, 1, cmd->color);
+            draw_fill(pannel, s, cmd->x, cmd->y, 1, cmd->h, cmd->color);
+            draw_fill(pannel, s, cmd->x + cmd->w - 1, cmd->y, 1, cmd->h, cmd->color);
+            break;
+        case PANNEL_CMD_LINE:
+            draw_line(pannel, s, cmd->x, cmd->y, cmd->w, cmd->h, cmd->color);
+            break;
+        case PANNEL_CMD_ROUND_RECT:
+        case PANNEL_CMD_ROUND_FILL:
+            draw_round_rect(pannel, s, cmd->x, cmd->y, cmd->w, cmd->h, cmd->r, cmd->color,
+                            cmd->type == PANNEL_CMD_ROUND_FILL);
+            break;
+        case PANNEL_CMD_TEXT:
+            draw_txt(pannel, s, cmd->data, cmd->x, cmd->y, cmd->color);
+            break;
+        case PANNEL_CMD_TEXT_BG:
+            draw_txt_bg(pannel, s, cmd->data, cmd->x, cmd->y, cmd->color, cmd->bg);
+            break;
+        case PANNEL_CMD_BUFFER:
+            draw_buffer(pannel, s, cmd->x, cmd->y, cmd->w, cmd->h, cmd->data);
+            break;
+        case PANNEL_CMD_IMAGE:
+            draw_image(pannel, s, cmd->x, cmd->y, cmd->data);
+            break;
+    }
+}
+
+/* clips the area to the clip rectangle, false when nothing is left */
+static bool pannel_clip_area(struct pannel_t *pannel, int *x0, int *y0, int *x1, int *y1)
+{
+    *x0 = MAX(*x0, pannel->clip.x0);
+    *y0 = MAX(*y0, pannel->clip.y0);
+    *x1 = MIN(*x1, pannel->clip.x1);
+    *y1 = MIN(*y1, pannel->clip.y1);
+
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+static void pannel_write(struct pannel_t *pannel, struct pannel_surface *s)
+{
+    struct display_buffer_descriptor desc;
+
+    desc.buf_size = ((s->h - 1) * s->pitch + s->w) * pannel->bytes_per_pixel;
+    desc.width = s->w;
+    desc.height = s->h;
+    desc.pitch = s->pitch;
+    desc.frame_incomplete = false;
+
+    sys_cache_data_flush_range(s->buf, desc.buf_size);
+    display_write(pannel->render_dev, s->x, s->y, &desc, s->buf);
+}
+
+#ifdef CONFIG_MENU_RENDER_FRAMEBUFFER
+/* the framebuffer must not change under a transfer */
+static void pannel_wait_idle(struct pannel_t *pannel)
+{
+#ifdef CONFIG_MENU_RENDER_ASYNC
+    k_sem_take(&pannel->flush_free, K_FOREVER);
+    k_sem_give(&pannel->flush_free);
+#endif
+}
+
+static void pannel_submit(struct pannel_t *pannel, const struct pannel_cmd *cmd, int x0, int y0, int x1, int y1)
+{
+    struct pannel_area *clip = &pannel->clip;
+    uint16_t pitch = pannel->caps.x_resolution;
+    struct pannel_surface fb;
+    struct pannel_rect dirty;
+
+    if (!pannel_clip_area(pannel, &x0, &y0, &x1, &y1))
+        return;
+
+    pannel_wait_idle(pannel);
+
+    /* the part of the framebuffer inside the clip rectangle */
+    fb.buf = (uint8_t *)pannel->buf + (clip->y0 * pitch + clip->x0) * pannel->bytes_per_pixel;
+    fb.x = clip->x0;
+    fb.y = clip->y0;
+    fb.w = clip->x1 - clip->x0;
+    fb.h = clip->y1 - clip->y0;
+    fb.pitch = pitch;
+
+    pannel_cmd_draw(pannel, &fb, cmd);
+
+    dirty.x = x0;
+    dirty.y = y0;
+    dirty.w = x1 - x0;
+    dirty.h = y1 - y0;
+    pannel_rect_list_add(pannel->batch->dirty, &pannel->batch->dirty_count, PANNEL_DIRTY_MAX, &dirty);
+}
+
+static bool pannel_batch_empty(const struct pannel_batch *batch)
+{
+    return !batch->dirty_count;
+}
+
+static void pannel_batch_send(struct pannel_t *pannel, struct pannel_batch *batch)
+{
+    uint16_t pitch = pannel->caps.x_resolution;
+    struct pannel_rect *dirty;
+    struct pannel_surface s;
+
+    for (dirty = batch->dirty; dirty < batch->dirty + batch->dirty_count; dirty++)
+    {
+        s.buf = (uint8_t *)pannel->buf + (dirty->y * pitch + dirty->x) * pannel->bytes_per_pixel;
+        s.x = dirty->x;
+        s.y = dirty->y;
+        s.w = dirty->w;
+        s.h = dirty->h;
+        s.pitch = pitch;
+
+        pannel_write(pannel, &s);
+    }
+
+    batch->dirty_count = 0;
+}
+#else
+/* a solid span straight to the display, the band buffer holds the pattern */
+static void pannel_write_fill(struct pannel_t *pannel, int x, int y, int w, int h, uint32_t color)
+{
+    size_t row_size = w * pannel->bytes_per_pixel;
+    int lines = MIN(pannel->buf_size / row_size, h);
+    struct pannel_surface s = {
+        .buf = pannel->buf,
+        .x = x,
+        .w = w,
+        .pitch = w,
+    };
+
+    pannel->ops->fill(s.buf, color, w);
+    for (int i = 1; i < lines; i++)
+        memcpy(s.buf + i * row_size, s.buf, row_size);
+
+    for (s.y = y; s.y < y + h; s.y += s.h)
+    {
+        s.h = MIN(lines, y + h - s.y);
+        pannel_write(pannel, &s);
+    }
+}
+
+static bool pannel_area_inside(const struct pannel_area *a, const struct pannel_area *b)
+{
+    return a->x0 >= b->x0 && a->y0 >= b->y0 && a->x1 <= b->x1 && a->y1 <= b->y1;
+}
+
+static bool pannel_area_covered(const struct pannel_batch *batch, const struct pannel_area *area)
+{
+    for (int i = 0; i < batch->area_count; i++)
+    {
+        if (pannel_area_inside(area, &batch->areas[i]))
+            return true;
+    }
+
+    return false;
+}
+
+static bool pannel_cmd_opaque(const struct pannel_cmd *cmd)
+{
+    return cmd->type == PANNEL_CMD_FILL || cmd->type == PANNEL_CMD_TEXT_BG ||
+           cmd->type == PANNEL_CMD_BUFFER || cmd->type == PANNEL_CMD_IMAGE;
+}
+
+/* drops the primitives and areas an opaque primitive over area hides */
+static void pannel_batch_cover(struct pannel_batch *batch, const struct pannel_area *area)
+{
+    struct pannel_cmd *cmd, *dst;
+    size_t off, keep = 0;
+    int n = 0;
 
-    while (x_pos >= y_pos) {
-        draw_circle_point(pannel, x + x_pos, y + y_pos, color);
-        draw_circle_point(pannel, x + y_pos, y + x_pos, color);
-        draw_circle_point(pannel, x - y_pos, y + x_pos, color);
-        draw_circle_point(pannel, x - x_pos, y + y_pos, color);
-        draw_circle_point(pannel, x - x_pos, y - y_pos, color);
-        draw_circle_point(pannel, x - y_pos, y - x_pos, color);
-        draw_circle_point(pannel, x + y_pos, y - x_pos, color);
-        draw_circle_point(pannel, x + x_pos, y - y_pos, color);
+    for (off = 0; off < batch->used; off += cmd->size)
+    {
+        cmd = (struct pannel_cmd *)(batch->cmds + off);
+        if (pannel_area_inside(&cmd->area, area))
+            continue;
 
-        if (err <= 0) {
-            y_pos += 1;
-            err += 2 * y_pos + 1;
+        if (keep != off)
+        {
+            dst = (struct pannel_cmd *)(batch->cmds + keep);
+            /* recorded text follows its command and moves along */
+            memmove(dst, cmd, cmd->size);
+            if (dst->data == cmd + 1)
+                dst->data = dst + 1;
+            cmd = dst;
         }
-        if (err > 0) {
-            x_pos -= 1;
-            err -= 2 * x_pos + 1;
+        keep += cmd->size;
+    }
+    batch->used = keep;
+
+    for (int i = 0; i < batch->area_count; i++)
+    {
+        if (!pannel_area_inside(&batch->areas[i], area))
+            batch->areas[n++] = batch->areas[i];
+    }
+    batch->area_count = n;
+}
+
+/* draws a recorded primitive into the part of s inside its clipped bounds */
+static void pannel_cmd_replay(struct pannel_t *pannel, const struct pannel_surface *s, const struct pannel_cmd *cmd)
+{
+    struct pannel_surface sub = *s;
+    int x0 = MAX(s->x, cmd->area.x0);
+    int y0 = MAX(s->y, cmd->area.y0);
+    int x1 = MIN(s->x + s->w, cmd->area.x1);
+    int y1 = MIN(s->y + s->h, cmd->area.y1);
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    if (!s->direct)
+        sub.buf += ((y0 - s->y) * s->pitch + (x0 - s->x)) * pannel->bytes_per_pixel;
+    sub.x = x0;
+    sub.y = y0;
+    sub.w = x1 - x0;
+    sub.h = y1 - y0;
+
+    pannel_cmd_draw(pannel, &sub, cmd);
+}
+
+/* the area band by band, each composed from everything recorded over it */
+static void pannel_area_send(struct pannel_t *pannel, struct pannel_batch *batch, const struct pannel_area *area)
+{
+    const struct pannel_cmd *cmd;
+    struct pannel_surface s = { .buf = pannel->buf };
+    size_t off;
+    int lines;
+
+    s.x = area->x0;
+    s.w = area->x1 - area->x0;
+    s.pitch = s.w;
+
+    /* narrow regions get taller bands out of the same buffer */
+    lines = pannel->buf_size / (s.w * pannel->bytes_per_pixel);
+
+    for (s.y = area->y0; s.y < area->y1; s.y += s.h)
+    {
+        s.h = MIN(lines, area->y1 - s.y);
+
+        for (off = 0; off < batch->used; off += cmd->size)
+        {
+            cmd = (const struct pannel_cmd *)(batch->cmds + off);
+            pannel_cmd_replay(pannel, &s, cmd);
         }
+
+        pannel_write(pannel, &s);
+    }
+}
+
+static bool pannel_batch_empty(const struct pannel_batch *batch)
+{
+    return !batch->used;
+}
+
+/*
+ * Primitives with nothing opaque under them go out first, span by span, the
+ * covered areas follow and overwrite them where they overlap, as the order
+ * of recording wants.
+ */
+static void pannel_batch_send(struct pannel_t *pannel, struct pannel_batch *batch)
+{
+    const struct pannel_cmd *cmd;
+    struct pannel_surface s = {
+        .w = pannel->caps.x_resolution,
+        .h = pannel->caps.y_resolution,
+        .direct = true,
+    };
+    size_t off;
+
+    for (off = 0; off < batch->used; off += cmd->size)
+    {
+        cmd = (const struct pannel_cmd *)(batch->cmds + off);
+        if (cmd->direct)
+            pannel_cmd_replay(pannel, &s, cmd);
+    }
+
+    for (int i = 0; i < batch->area_count; i++)
+        pannel_area_send(pannel, batch, &batch->areas[i]);
+
+    batch->used = 0;
+    batch->area_count = 0;
+}
+
+static void pannel_submit(struct pannel_t *pannel, const struct pannel_cmd *cmd, int x0, int y0, int x1, int y1)
+{
+    bool txt = cmd->type == PANNEL_CMD_TEXT || cmd->type == PANNEL_CMD_TEXT_BG;
+    size_t txt_len = txt ? strlen(cmd->data) + 1 : 0;
+    size_t size = ROUND_UP(sizeof(*cmd) + txt_len, sizeof(void *));
+    bool opaque = pannel_cmd_opaque(cmd);
+    struct pannel_batch *batch = pannel->batch;
+    struct pannel_area area;
+    struct pannel_cmd *dst;
+    bool covered;
+
+    if (size > pannel->cmds_size || !pannel_clip_area(pannel, &x0, &y0, &x1, &y1))
+        return;
+
+    area.x0 = x0;
+    area.y0 = y0;
+    area.x1 = x1;
+    area.y1 = y1;
+
+    if (opaque)
+        pannel_batch_cover(batch, &area);
+
+    /*
+     * Out of room, send what is recorded so far and start a new batch. It
+     * only adds to what the display shows, nothing is cleared under it.
+     */
+    covered = pannel_area_covered(batch, &area);
+    if (batch->used + size > pannel->cmds_size ||
+        (opaque && !covered && batch->area_count == PANNEL_AREAS_MAX))
+    {
+        pannel_flush(pannel);
+        batch = pannel->batch;
+        covered = false;
+    }
+
+    dst = (struct pannel_cmd *)(batch->cmds + batch->used);
+    *dst = *cmd;
+    dst->size = size;
+    dst->area = area;
+    dst->direct = !opaque && !covered;
+
+    if (txt_len)
+    {
+        memcpy(dst + 1, cmd->data, txt_len);
+        dst->data = dst + 1;
+    }
+
+    if (opaque && !covered)
+        batch->areas[batch->area_count++] = area;
+
+    batch->used += size;
+}
+#endif
+
+#ifdef CONFIG_MENU_RENDER_ASYNC
+static void pannel_flush_thread(void *p1, void *p2, void *p3)
+{
+    struct pannel_t *pannel = p1;
+    struct pannel_batch *batch;
+
+    while (1)
+    {
+        k_msgq_get(&pannel->flush_q, &batch, K_FOREVER);
+        pannel_batch_send(pannel, batch);
+        /* completion, the batch can be recorded or drawn into again */
+        k_sem_give(&pannel->flush_free);
+    }
+}
+
+/*
+ * Hands the batch to the flush thread and returns. Strip mode records into
+ * the other batch meanwhile and only waits when both are in flight, the
+ * framebuffer waits for the transfer at the next primitive instead.
+ */
+void pannel_flush(struct pannel_t *pannel)
+{
+#ifdef CONFIG_MENU_RENDER_FRAMEBUFFER
+    k_sem_take(&pannel->flush_free, K_FOREVER);
+
+    if (pannel_batch_empty(pannel->batch))
+    {
+        k_sem_give(&pannel->flush_free);
+        return;
     }
+
+    k_msgq_put(&pannel->flush_q, &pannel->batch, K_FOREVER);
+#else
+    struct pannel_batch *next;
+
+    if (pannel_batch_empty(pannel->batch))
+        return;
+
+    k_msgq_put(&pannel->flush_q, &pannel->batch, K_FOREVER);
+
+    k_sem_take(&pannel->flush_free, K_FOREVER);
+    next = pannel->batch == &pannel->batches[0] ? &pannel->batches[1] : &pannel->batches[0];
+    pannel->batch = next;
+#endif
+}
+#else
+void pannel_flush(struct pannel_t *pannel)
+{
+    if (!pannel || pannel_batch_empty(pannel->batch))
+        return;
+
+    pannel_batch_send(pannel, pannel->batch);
+}
+#endif
+
+/*
+ * Sends the rest of a frame. The emulated display closes its cost counters
+ * once every batch of it is written, however many the command buffer took;
+ * on hardware the tail keeps overlapping the next frame.
+ */
+void pannel_frame_end(struct pannel_t *pannel)
+{
+    if (!pannel)
+        return;
+
+    pannel_flush(pannel);
+
+#ifdef CONFIG_DISPLAY_SIM
+#ifdef CONFIG_MENU_RENDER_ASYNC
+    k_sem_take(&pannel->flush_free, K_FOREVER);
+    k_sem_give(&pannel->flush_free);
+#endif
+    display_sim_frame_end(pannel->render_dev);
+#endif
+}
+
+void pannel_render_line(struct pannel_t *pannel, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color)
+{
+    struct pannel_cmd cmd = {
+        .type = PANNEL_CMD_LINE,
+        .x = x0,
+        .y = y0,
+        .w = x1,
+        .h = y1,
+        .color = color,
+    };
+
+    if (!pannel)
+        return;
+
+    pannel_submit(pannel, &cmd, MIN(x0, x1), MIN(y0, y1), MAX(x0, x1) + 1, MAX(y0, y1) + 1);
+}
+
+void pannel_render_txt(struct pannel_t *pannel, uint8_t *txt, uint16_t x, uint16_t y, uint16_t color)
+{
+    struct pannel_cmd cmd = {
+        .type = PANNEL_CMD_TEXT,
+        .x = x,
+        .y = y,
+        .color = color,
+        .data = txt,
+    };
+
+    if (!pannel || !txt || !*txt) {
+        return;
+    }
+
+    pannel_submit(pannel, &cmd, x, y, x + strlen((char *)txt) * pannel->font_size, y + pannel->font_size);
+}
+
+/* text on a solid background, no need to clear the area first */
+void pannel_render_txt_bg(struct pannel_t *pannel, uint8_t *txt, uint16_t x, uint16_t y, uint16_t color, uint16_t bg)
+{
+    struct pannel_cmd cmd = {
+        .type = PANNEL_CMD_TEXT_BG,
+        .x = x,
+        .y = y,
+        .color = color,
+        .bg = bg,
+        .data = txt,
+    };
+
+    if (!pannel || !txt || !*txt) {
+        return;
+    }
+
+    pannel_submit(pannel, &cmd, x, y, x + strlen((char *)txt) * pannel->font_size, y + pannel->font_size);
+}
+
+void pannel_render_rect(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color, bool fill)
+{
+    struct pannel_cmd cmd = {
+        .type = fill ? PANNEL_CMD_FILL : PANNEL_CMD_RECT,
+        .x = x,
+        .y = y,
+        .w = w,
+        .h = h,
+        .color = color,
+    };
+
+    if (!pannel || !w || !h) {
+        return;
+    }
+
+    pannel_submit(pannel, &cmd, x, y, x + w, y + h);
+}
+
+static void pannel_submit_round(struct pannel_t *pannel, int x, int y, int w, int h, int r, uint32_t color, bool fill)
+{
+    struct pannel_cmd cmd = {
+        .type = fill ? PANNEL_CMD_ROUND_FILL : PANNEL_CMD_ROUND_RECT,
+        .x = x,
+        .y = y,
+        .w = w,
+        .h = h,
+        .r = r,
+        .color = color,
+    };
+
+    if (!pannel || !w || !h) {
+        return;
+    }
+
+    pannel_submit(pannel, &cmd, x, y, x + w, y + h);
+}
+
+void pannel_render_round_rect(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t radius, uint16_t color, bool fill)
+{
+    pannel_submit_round(pannel, x, y, w, h, radius, color, fill);
+}
+
+void pannel_render_circle(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t radius, uint16_t color)
+{
+    pannel_submit_round(pannel, x - radius, y - radius, 2 * radius + 1, 2 * radius + 1, radius, color, false);
+}
+
+void pannel_render_circle_fill(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t radius, uint16_t color)
+{
+    pannel_submit_round(pannel, x - radius, y - radius, 2 * radius + 1, 2 * radius + 1, radius, color, true);
+}
+
+static void pannel_glyph_init(struct pannel_t *pannel)
+{
+    size_t glyph_size = pannel->font_size * pannel->font_size * pannel->bytes_per_pixel;
+    uint8_t *buf = NULL;
+    int i;
+
+#if CONFIG_MENU_GLYPH_CACHE_SIZE > 0
+#ifdef CONFIG_MENU_STATIC_ALLOC
+    buf = pannel_glyph_buf;
+#else
+    buf = k_malloc(PANNEL_GLYPH_BUF_SIZE);
+#endif
+#endif
+
+    if (!buf)
+        return;
+
+    pannel->glyph_count = MIN(CONFIG_MENU_GLYPH_CACHE_SIZE, PANNEL_GLYPH_BUF_SIZE / glyph_size);
+
+    for (i = 0; i < pannel->glyph_count; i++)
+        pannel->glyphs[i].pixels = buf + i * glyph_size;
 }
 
 struct pannel_t *pannel_create(const struct device *render_dev)
 {
     struct pannel_t *pannel;
-    uint16_t buf_size;
+    size_t buf_size;
 
     if (!device_is_ready(render_dev))
     {
         return NULL;
     }
 
+#ifdef CONFIG_MENU_STATIC_ALLOC
+    pannel = &pannel_instance;
+#else
     pannel = k_malloc(sizeof(*pannel));
+#endif
 
     if (pannel)
     {
+        memset(pannel, 0, sizeof(*pannel));
         pannel->render_dev = render_dev;
 
-#ifndef CONFIG_FONT_SIZE
-#define CONFIG_FONT_SIZE 16
-#endif
         pannel->font_size = CONFIG_FONT_SIZE;
 
         display_get_capabilities(render_dev, &pannel->caps);
@@ -250,104 +1212,239 @@ struct pannel_t *pannel_create(const struct device *render_dev)
         switch(pannel->caps.current_pixel_format)
         {
             case PIXEL_FORMAT_ARGB_8888:
-                pannel->bytes_per_pixel = 4;
+                pannel->ops = &pannel_pixel_ops_32;
                 break;
             case PIXEL_FORMAT_RGB_888:
-                pannel->bytes_per_pixel = 3;
+                pannel->ops = &pannel_pixel_ops_24;
                 break;
             case PIXEL_FORMAT_BGR_565:
             case PIXEL_FORMAT_RGB_565:
             case PIXEL_FORMAT_AL_88:
-                pannel->bytes_per_pixel = 2;
+                pannel->ops = &pannel_pixel_ops_16;
                 break;
             case PIXEL_FORMAT_L_8:
             case PIXEL_FORMAT_MONO01:
             case PIXEL_FORMAT_MONO10:
-                pannel->bytes_per_pixel = 1;
+                pannel->ops = &pannel_pixel_ops_8;
                 break;
             default:
+#ifndef CONFIG_MENU_STATIC_ALLOC
                 k_free(pannel);
+#endif
                 return NULL;
 
         }
+        pannel->bytes_per_pixel = pannel->ops->bpp;
 
-        buf_size = pannel->caps.x_resolution * pannel->bytes_per_pixel;
+#ifdef CONFIG_MENU_RENDER_FRAMEBUFFER
+        buf_size = pannel->caps.x_resolution * pannel->caps.y_resolution * pannel->bytes_per_pixel;
+#else
+        buf_size = pannel->caps.x_resolution * CONFIG_MENU_RENDER_STRIP_LINES * pannel->bytes_per_pixel;
+#endif
         pannel->buf_size = buf_size;
+#ifdef CONFIG_MENU_STATIC_ALLOC
+        if (buf_size > sizeof(pannel_buf))
+            return NULL;
+        pannel->buf = pannel_buf;
+#ifdef CONFIG_MENU_RENDER_STRIP
+        for (int i = 0; i < PANNEL_BATCHES; i++)
+            pannel->batches[i].cmds = pannel_cmd_buf[i];
+#endif
+#else
         pannel->buf = k_malloc(buf_size);
         if (!pannel->buf)
         {
             k_free(pannel);
             return NULL;
         }
+#ifdef CONFIG_MENU_RENDER_STRIP
+        for (int i = 0; i < PANNEL_BATCHES; i++)
+        {
+            pannel->batches[i].cmds = k_malloc(CONFIG_MENU_RENDER_CMD_BUF_SIZE);
+            if (!pannel->batches[i].cmds)
+            {
+                while (i--)
+                    k_free(pannel->batches[i].cmds);
+                k_free(pannel->buf);
+                k_free(pannel);
+                return NULL;
+            }
+        }
+#endif
+#endif
+#ifdef CONFIG_MENU_RENDER_STRIP
+        pannel->cmds_size = CONFIG_MENU_RENDER_CMD_BUF_SIZE;
+#endif
+        pannel->batch = &pannel->batches[0];
+        pannel_glyph_init(pannel);
+        pannel_clip_set(pannel, NULL);
+
+#ifdef CONFIG_MENU_RENDER_ASYNC
+        k_msgq_init(&pannel->flush_q, (char *)pannel->flush_q_buf, sizeof(struct pannel_batch *), PANNEL_BATCHES);
+        /* the spare batch in strip mode, an idle framebuffer otherwise */
+        k_sem_init(&pannel->flush_free, 1, 1);
+        k_thread_create(&pannel->flush_thread, pannel->flush_stack, PANNEL_FLUSH_STACK_SIZE,
+                        pannel_flush_thread, pannel, NULL, NULL, PANNEL_FLUSH_PRIORITY, 0, K_NO_WAIT);
+#endif
     }
 
     return pannel;
 }
 
-int pannel_get_capabilities(struct pannel_t *pannel, struct display_capabilities **caps)
+/*
+ * Limits drawing to a rectangle, NULL for the whole screen. Recorded
+ * primitives keep the clip they were drawn with, a batch can span several.
+ */
+void pannel_clip_set(struct pannel_t *pannel, const struct pannel_rect *rect)
 {
-    if (!pannel || !pannel->render_dev || !caps) {
-        return -EINVAL;
-    }
-    
-    *caps = &pannel->caps;
-    
-    return 0;
+    int x0 = 0, y0 = 0, x1 = pannel->caps.x_resolution, y1 = pannel->caps.y_resolution;
+
+    pannel->clip.x0 = x0;
+    pannel->clip.y0 = y0;
+    pannel->clip.x1 = x1;
+    pannel->clip.y1 = y1;
+
+    if (!rect)
+        return;
+
+    x0 = rect->x;
+    y0 = rect->y;
+    x1 = rect->x + rect->w;
+    y1 = rect->y + rect->h;
+
+    if (!pannel_clip_area(pannel, &x0, &y0, &x1, &y1))
+        x1 = x0;
+
+    pannel->clip.x0 = x0;
+    pannel->clip.y0 = y0;
+    pannel->clip.x1 = x1;
+    pannel->clip.y1 = y1;
 }
 
-void pannel_render_clear(struct pannel_t *pannel, uint32_t color)
+static bool pannel_rect_touch(const struct pannel_rect *a, const struct pannel_rect *b)
+{
+    return a->x <= b->x + b->w && b->x <= a->x + a->w &&
+           a->y <= b->y + b->h && b->y <= a->y + a->h;
+}
+
+static void pannel_rect_union(struct pannel_rect *a, const struct pannel_rect *b)
 {
-    size_t row_buf_size = pannel->buf_size;
-    uint8_t *row_buf = pannel->buf;
-    struct display_buffer_descriptor desc = {0};
+    uint16_t x1 = MAX(a->x + a->w, b->x + b->w);
+    uint16_t y1 = MAX(a->y + a->h, b->y + b->h);
 
-    for (size_t i = 0; i < row_buf_size; i += pannel->bytes_per_pixel)
+    a->x = MIN(a->x, b->x);
+    a->y = MIN(a->y, b->y);
+    a->w = x1 - a->x;
+    a->h = y1 - a->y;
+}
+
+/*
+ * Rectangles that touch are merged, a full list folds the new one into the
+ * rectangle it grows the least. Keeps the framebuffer dirty list and the
+ * menu damage list.
+ */
+void pannel_rect_list_add(struct pannel_rect *list, uint8_t *count, uint8_t max, const struct pannel_rect *rect)
+{
+    struct pannel_rect r = *rect;
+    struct pannel_rect u;
+    uint32_t cost, best_cost;
+    int i, best;
+
+again:
+    for (i = 0; i < *count; i++)
     {
-        switch(pannel->bytes_per_pixel)
+        if (pannel_rect_touch(&list[i], &r))
         {
-            case 1:
-                row_buf[i] = color & 0xff;
-                break;
-            case 2:
-                *(uint16_t *)(row_buf + i) = color & 0xffff;
-                break;
-            case 3:
-                row_buf[i] = (color >> 16) & 0xff;
-                row_buf[i + 1] = (color >> 8) & 0xff;
-                row_buf[i + 2] = color & 0xff;
-                break;
-            default:
-                *(uint32_t *)(row_buf + i) = color;
+            pannel_rect_union(&r, &list[i]);
+            list[i] = list[--(*count)];
+            goto again;
         }
     }
 
-    desc.buf_size = row_buf_size;
-    desc.width = pannel->caps.x_resolution;
-    desc.height = 1;
-    desc.pitch = pannel->caps.x_resolution;
-    desc.frame_incomplete = false;
+    if (*count == max)
+    {
+        best = 0;
+        best_cost = UINT32_MAX;
+        for (i = 0; i < *count; i++)
+        {
+            u = list[i];
+            pannel_rect_union(&u, &r);
+            cost = (uint32_t)u.w * u.h - (uint32_t)list[i].w * list[i].h;
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best = i;
+            }
+        }
+        pannel_rect_union(&r, &list[best]);
+        list[best] = list[--(*count)];
+        goto again;
+    }
 
-    for (uint16_t y = 0; y < pannel->caps.y_resolution; y++) {
-        display_write(pannel->render_dev, 0, y, &desc, row_buf);
+    list[(*count)++] = r;
+}
+
+bool pannel_clip_test(struct pannel_t *pannel, int x, int y, int w, int h)
+{
+    int x1 = x + w, y1 = y + h;
+
+    return pannel_clip_area(pannel, &x, &y, &x1, &y1);
+}
+
+int pannel_get_capabilities(struct pannel_t *pannel, struct display_capabilities **caps)
+{
+    if (!pannel || !pannel->render_dev || !caps) {
+        return -EINVAL;
     }
+
+    *caps = &pannel->caps;
+
+    return 0;
 }
+
+void pannel_render_clear(struct pannel_t *pannel, uint32_t color)
+{
+    struct pannel_cmd cmd = {
+        .type = PANNEL_CMD_FILL,
+        .w = pannel->caps.x_resolution,
+        .h = pannel->caps.y_resolution,
+        .color = color,
+    };
+
+    pannel_submit(pannel, &cmd, 0, 0, cmd.w, cmd.h);
+}
+
+/* buf must stay valid until the flush that sends it has completed */
 void pannel_render_buffer(struct pannel_t *pannel, uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t *buf)
 {
+    struct pannel_cmd cmd = {
+        .type = PANNEL_CMD_BUFFER,
+        .x = x,
+        .y = y,
+        .w = w,
+        .h = h,
+        .data = buf,
+    };
+
     if (!pannel || !buf) {
         return;
     }
 
-    struct display_buffer_descriptor desc;
-    size_t row_size = w * pannel->bytes_per_pixel;
+    pannel_submit(pannel, &cmd, x, y, x + w, y + h);
+}
 
-    desc.buf_size = row_size;
-    desc.width = w;
-    desc.height = 1;
-    desc.pitch = w;
-    desc.frame_incomplete = false;
+void pannel_render_image(struct pannel_t *pannel, uint16_t x, uint16_t y, const struct pannel_image *image)
+{
+    struct pannel_cmd cmd = {
+        .type = PANNEL_CMD_IMAGE,
+        .x = x,
+        .y = y,
+        .data = image,
+    };
 
-    for (uint16_t i = 0; i < h; i++) {
-        uint8_t *row_buf = buf + (i * row_size);
-        display_write(pannel->render_dev, x, y + i, &desc, row_buf);
+    if (!pannel || !image || !image->width || !image->height) {
+        return;
     }
-}
\ No newline at end of file
+
+    pannel_submit(pannel, &cmd, x, y, x + image->width, y + image->height);
+}
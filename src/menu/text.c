@@ -0,0 +1,112 @@
+#include <zephyr/sys/util.h>
+
+#include <text.h>
+
+#include <string.h>
+
+void text_init(struct text_buf *text, char *buf, size_t size)
+{
+    text->buf = buf;
+    text->size = size;
+    text->len = 0;
+
+    if (size)
+        buf[0] = '\0';
+}
+
+static void text_put(struct text_buf *text, const char *str, size_t n)
+{
+    if (text->len + 1 >= text->size)
+        return;
+
+    n = MIN(n, text->size - text->len - 1);
+    memcpy(text->buf + text->len, str, n);
+    text->len += n;
+    text->buf[text->len] = '\0';
+}
+
+void text_append(struct text_buf *text, const char *str)
+{
+    text_put(text, str, strlen(str));
+}
+
+void text_append_char(struct text_buf *text, char c)
+{
+    text_put(text, &c, 1);
+}
+
+/* digits of u, most significant first, at least min digits */
+static size_t text_digits(char *out, uint32_t u, uint8_t min)
+{
+    char tmp[10];
+    size_t n = 0, i;
+
+    do
+    {
+        tmp[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u || n < min);
+
+    for (i = 0; i < n; i++)
+        out[i] = tmp[n - 1 - i];
+
+    return n;
+}
+
+void text_append_int(struct text_buf *text, int32_t value)
+{
+    char out[11];
+    size_t n = 0;
+
+    if (value < 0)
+        out[n++] = '-';
+
+    n += text_digits(out + n, value < 0 ? -(uint32_t)value : (uint32_t)value, 1);
+    text_put(text, out, n);
+}
+
+/*
+ * value holds 10^-scale units, e.g. millivolts with scale 3. Prints frac
+ * decimals, the dropped digits rounded half up like printf.
+ */
+void text_append_fixed(struct text_buf *text, int32_t value, uint8_t scale, uint8_t frac)
+{
+    uint32_t u = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    uint32_t step = 1;
+    uint32_t unit = 1;
+    char out[24];
+    size_t n = 0;
+    uint8_t i;
+
+    frac = MIN(frac, scale);
+    for (i = frac; i < scale; i++)
+        step *= 10;
+    for (i = 0; i < frac; i++)
+        unit *= 10;
+
+    /* |value| <= 2^31 and step / 2 < 2^29, the sum fits */
+    u = (u + step / 2) / step;
+
+    if (value < 0)
+        out[n++] = '-';
+
+    n += text_digits(out + n, u / unit, 1);
+
+    if (frac)
+    {
+        out[n++] = '.';
+        n += text_digits(out + n, u % unit, frac);
+    }
+
+    text_put(text, out, n);
+}
+
+size_t text_int(char *buf, size_t size, int32_t value)
+{
+    struct text_buf text;
+
+    text_init(&text, buf, size);
+    text_append_int(&text, value);
+
+    return text.len;
+}
@@ -2,87 +2,292 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <motor/adc.h>
+#include <motor/prof.h>
 
-#define ADC_THREAD_STACK_SIZE   512
-#define OVER_SAMPLE 0
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#ifdef CONFIG_MC_ADC_CURRENT_INJECTED
+#include <stm32_ll_adc.h>
+#include <stm32_ll_tim.h>
+
+#define ADC_CURRENT_NODE    DT_ALIAS(adc2)
+#define ADC_CURRENT_TIMER   DT_PARENT(DT_ALIAS(pwm1))
+#define ADC_CURRENT_REGS    ((ADC_TypeDef *)DT_REG_ADDR(ADC_CURRENT_NODE))
+#define ADC_CURRENT_TIM     ((TIM_TypeDef *)DT_REG_ADDR(ADC_CURRENT_TIMER))
+
+BUILD_ASSERT(DT_REG_ADDR(ADC_CURRENT_TIMER) == TIM1_BASE, "injected trigger expects the PWM on TIM1");
+#endif
+
+#define ADC_SCAN_BLOCK_SIZE CONFIG_MC_ADC_SCAN_BLOCK_SIZE
 
 struct adc_t {
     const struct adc_info *info;
-    struct k_thread thread;
-    k_tid_t tid;
-    K_KERNEL_STACK_MEMBER(thread_stack, ADC_THREAD_STACK_SIZE);
-    struct adc_callback_t **callbacks;
+    struct adc_sequence_options opts;
+    struct adc_sequence seq;
+    struct k_poll_signal done_signal;
+    /* one scan as written by the driver, in ascending hardware channel order */
+    uint16_t scan_buf[ADC_CHANNEL_COUNT];
+    uint8_t slot[ADC_CHANNEL_COUNT];
+    /* ping/pong buffer, each half holds ADC_SCAN_BLOCK_SIZE scans */
+    uint16_t blocks[2][ADC_SCAN_BLOCK_SIZE][ADC_CHANNEL_COUNT];
+    uint16_t scan_index;
+    uint8_t ready_block;
+    uint32_t ready_stamp;
+    struct k_work work;
+    uint16_t chan_buf[ADC_SCAN_BLOCK_SIZE];
+    struct adc_callback_t *callbacks[ADC_CHANNEL_COUNT];
+    struct adc_scan_callback_t *scan_callbacks;
+    struct adc_stream_t *streams[ADC_CHANNEL_COUNT];
+    struct adc_current_callback_t *current_cb;
+    uint8_t current_aux;
+    uint32_t scan_exclude;
 };
 
 LOG_MODULE_REGISTER(adc, LOG_LEVEL_INF);
 
-static void adc_thread_entry(void *v1, void *v2, void *v3)
-{
-    struct adc_t *adc = v1;
-    struct adc_sequence_options opts = {0};
-    struct adc_sequence seq = { .options = &opts };
-    struct k_poll_signal done_signal = {0};
-    struct k_poll_event done_event = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &done_signal);
-    int i, chan_avai, buf_size = sizeof(uint16_t)  * adc->info->nb_channels;
-    uint16_t *buf = k_malloc(buf_size);
-    uint8_t *chan = k_malloc(adc->info->nb_channels);
-    const struct adc_channel_cfg *cfg;
+#ifdef CONFIG_MC_STATIC_ALLOC
+static struct adc_t adc_instance;
+#endif
+
+#ifdef CONFIG_SHELL
+static struct adc_t *shell_adc;
+#endif
+
+static inline void adc_stream_push(struct adc_t *adc, uint8_t id, uint16_t value)
+{
+    struct adc_stream_t *stream;
+
+    for (stream = adc->streams[id]; stream; stream = stream->next)
+    {
+        ring_put(&stream->ring, value);
+    }
+}
+
+static void adc_dispatch_work(struct k_work *work)
+{
+    struct adc_t *adc = CONTAINER_OF(work, struct adc_t, work);
+    uint16_t (*block)[ADC_CHANNEL_COUNT] = adc->blocks[adc->ready_block];
     struct adc_callback_t *cb;
+    int i, id;
 
-    seq.buffer = buf;
-    seq.buffer_size = buf_size;
-    seq.oversampling = 0;
-    seq.resolution = 12;
+    prof_record(PROF_ADC_DISPATCH, prof_now() - adc->ready_stamp);
 
-    while(true)
+    for (id = 0; id < ADC_CHANNEL_COUNT; id++)
     {
-        chan_avai = 0;
-        seq.channels = 0;
-        memset(chan, 0, adc->info->nb_channels);
+        if (!adc->callbacks[id])
+            continue;
 
-        for (i = 0; i < adc->info->nb_channels; i++)
+        for (i = 0; i < ADC_SCAN_BLOCK_SIZE; i++)
         {
-            if (adc->callbacks[i])
-            {
-                cfg = &adc->info->channels[i].cfg;
-                seq.channels |= BIT(cfg->channel_id);
-                chan[chan_avai++] = i;
-            }
+            adc->chan_buf[i] = block[i][id];
         }
 
-        if (chan_avai == 0)
+        for (cb = adc->callbacks[id]; cb; cb = cb->next)
         {
-            k_sleep(K_MSEC(100));
-            continue;
+            cb->func(cb, adc->chan_buf, sizeof(adc->chan_buf), cb->param);
         }
+    }
+}
 
-        adc_read_async(adc->info->dev, &seq, &done_signal);
+static enum adc_action adc_scan_sampling_done(const struct device *dev, const struct adc_sequence *seq, uint16_t sampling_index)
+{
+    PROF_START(start);
+    struct adc_t *adc = seq->options->user_data;
+    uint8_t block = adc->scan_index / ADC_SCAN_BLOCK_SIZE;
+    uint16_t *dst = adc->blocks[block][adc->scan_index % ADC_SCAN_BLOCK_SIZE];
+    struct adc_scan_callback_t *cb;
+    enum adc_scan_event event;
+    uint8_t id;
+    int i;
 
-        k_poll(&done_event, 1, K_MSEC(500));
+    for (i = 0; i < adc->info->nb_channels; i++)
+    {
+        id = adc->info->channels[i].id;
+        if (!(adc->scan_exclude & BIT(id)))
+        {
+            dst[id] = adc->scan_buf[adc->slot[id]];
+            adc_stream_push(adc, id, dst[id]);
+        }
+    }
+
+#ifndef CONFIG_MC_ADC_CURRENT_INJECTED
+    if (adc->current_cb)
+    {
+        struct adc_current_samples samples = {
+            .curr_a = dst[CURR_A],
+            .curr_c = dst[CURR_C],
+            .aux = dst[adc->current_aux],
+        };
+
+        adc->current_cb->func(adc->current_cb, &samples, adc->current_cb->param);
+    }
+#endif
+
+    if (++adc->scan_index % ADC_SCAN_BLOCK_SIZE == 0)
+    {
+        event = block ? ADC_SCAN_FULL_COMPLETE : ADC_SCAN_HALF_COMPLETE;
 
-        if (done_event.signal->result == 0)
+        for (cb = adc->scan_callbacks; cb; cb = cb->next)
         {
-            for (i = 0; i < chan_avai; i++)
-            {
-                uint16_t value = buf[i];
-                for (cb = adc->callbacks[chan[i]]; cb; cb = cb->next)
-                {
-                    cb->func(cb, &value, 2, NULL);
-                }
-            }
+            cb->func(cb, &adc->blocks[block][0][0], ADC_SCAN_BLOCK_SIZE, event);
         }
 
-        done_event.state = K_POLL_STATE_NOT_READY;
-        k_poll_signal_reset(&done_signal);
+        adc->ready_block = block;
+        adc->ready_stamp = prof_now();
+        k_work_submit(&adc->work);
+
+        if (adc->scan_index == 2 * ADC_SCAN_BLOCK_SIZE)
+            adc->scan_index = 0;
+    }
+
+    PROF_STOP(PROF_ADC_SCAN, start);
+
+    /* re-arm the same scan; the driver restarts it on the next interval */
+    return ADC_ACTION_REPEAT;
+}
+
+static void adc_scan_setup(struct adc_t *adc)
+{
+    const struct adc_channel_info *ch;
+    uint32_t mask = 0;
+    int i;
+
+    for (i = 0; i < adc->info->nb_channels; i++)
+    {
+        ch = &adc->info->channels[i];
+        if (!(adc->scan_exclude & BIT(ch->id)))
+            mask |= BIT(ch->cfg.channel_id);
+    }
+
+    /* the driver stores a scan in ascending channel number order */
+    for (i = 0; i < adc->info->nb_channels; i++)
+    {
+        ch = &adc->info->channels[i];
+        adc->slot[ch->id] = __builtin_popcount(mask & (BIT(ch->cfg.channel_id) - 1));
+    }
+
+    adc->seq.channels = mask;
+    adc->seq.buffer_size = __builtin_popcount(mask) * sizeof(uint16_t);
+}
+
+#ifdef CONFIG_MC_ADC_CURRENT_INJECTED
+static struct adc_t *current_adc;
+
+static const struct adc_channel_info *adc_channel_find(struct adc_t *adc, uint8_t id)
+{
+    int i;
+
+    for (i = 0; i < adc->info->nb_channels; i++)
+    {
+        if (adc->info->channels[i].id == id)
+            return &adc->info->channels[i];
     }
+
+    return NULL;
+}
+
+static void adc_current_isr(const void *arg)
+{
+    PROF_START(start);
+    ADC_TypeDef *regs = ADC_CURRENT_REGS;
+    struct adc_current_callback_t *cb;
+    struct adc_current_samples samples;
+
+    /* the line is shared with the regular conversion driver */
+    if (!LL_ADC_IsEnabledIT_JEOS(regs) || !LL_ADC_IsActiveFlag_JEOS(regs))
+        return;
+
+    LL_ADC_ClearFlag_JEOS(regs);
+
+    samples.curr_a = LL_ADC_INJ_ReadConversionData12(regs, LL_ADC_INJ_RANK_1);
+    samples.curr_c = LL_ADC_INJ_ReadConversionData12(regs, LL_ADC_INJ_RANK_2);
+    samples.aux = LL_ADC_INJ_ReadConversionData12(regs, LL_ADC_INJ_RANK_3);
+
+    adc_stream_push(current_adc, CURR_A, samples.curr_a);
+    adc_stream_push(current_adc, CURR_C, samples.curr_c);
+
+    cb = current_adc->current_cb;
+    cb->func(cb, &samples, cb->param);
+
+    PROF_STOP(PROF_CURRENT_ISR, start);
+}
+
+/*
+ * While JADSTART is set JSQR is a queue of whole contexts, ranks and
+ * trigger together, each write pushes one that the next trigger picks up.
+ * Build it in a single write; a read-modify-write of one rank would copy
+ * whatever context is active at that moment.
+ */
+static int adc_current_context(struct adc_t *adc, uint8_t aux_id)
+{
+    const struct adc_channel_info *curr_a = adc_channel_find(adc, CURR_A);
+    const struct adc_channel_info *curr_c = adc_channel_find(adc, CURR_C);
+    const struct adc_channel_info *aux = adc_channel_find(adc, aux_id);
+    uint32_t aux_channel;
+
+    if (!curr_a || !curr_c || !aux)
+        return -EINVAL;
+
+    aux_channel = __LL_ADC_DECIMAL_NB_TO_CHANNEL(aux->cfg.channel_id);
+
+    LL_ADC_INJ_ConfigQueueContext(ADC_CURRENT_REGS, LL_ADC_INJ_TRIG_EXT_TIM1_TRGO2, LL_ADC_INJ_TRIG_EXT_RISING,
+                                  LL_ADC_INJ_SEQ_SCAN_ENABLE_3RANKS,
+                                  __LL_ADC_DECIMAL_NB_TO_CHANNEL(curr_a->cfg.channel_id),
+                                  __LL_ADC_DECIMAL_NB_TO_CHANNEL(curr_c->cfg.channel_id),
+                                  aux_channel, aux_channel);
+
+    return 0;
+}
+
+static int adc_current_start(struct adc_t *adc)
+{
+    ADC_TypeDef *regs = ADC_CURRENT_REGS;
+    TIM_TypeDef *tim = ADC_CURRENT_TIM;
+    int ret;
+
+    /* the trigger below only marks the carrier center when counting up and down */
+    if (!(LL_TIM_GetCounterMode(tim) & TIM_CR1_CMS))
+    {
+        LOG_ERR("injected current sampling needs a center-aligned PWM timer");
+        return -ENOTSUP;
+    }
+
+    ret = adc_current_context(adc, adc->current_aux);
+    if (ret)
+        return ret;
+
+    current_adc = adc;
+
+    IRQ_CONNECT(DT_IRQN(ADC_CURRENT_NODE), DT_IRQ(ADC_CURRENT_NODE, priority), adc_current_isr, NULL, 0);
+    irq_enable(DT_IRQN(ADC_CURRENT_NODE));
+
+    /*
+     * OC4REF is active only while the counter is 0, so its rising edge is
+     * the underflow whatever the period. The update event can't be used:
+     * with a repetition counter it lands on the underflow or the overflow
+     * depending on where the counter was when it started.
+     */
+    LL_TIM_OC_SetMode(tim, LL_TIM_CHANNEL_CH4, LL_TIM_OCMODE_PWM1);
+    LL_TIM_OC_SetCompareCH4(tim, 1);
+    LL_TIM_SetTriggerOutput2(tim, LL_TIM_TRGO2_OC4);
+
+    LL_ADC_ClearFlag_JEOS(regs);
+    LL_ADC_EnableIT_JEOS(regs);
+    LL_ADC_INJ_StartConversion(regs);
+
+    return 0;
 }
+#endif
 
 struct adc_t *adc_init(const struct adc_info *info)
 {
     struct adc_t *adc;
     size_t alloc_size;
+    int i;
 
-    if (info && (!info->channels || !info->dev || !info->nb_channels))
+    if (!info || !info->channels || !info->dev || !info->nb_channels || info->nb_channels > ADC_CHANNEL_COUNT)
     {
         LOG_ERR("adc info Invalid");
         return NULL;
@@ -94,46 +299,53 @@ struct adc_t *adc_init(const struct adc_info *info)
         return NULL;
     }
 
-    for (int i = 0; i < info->nb_channels; i++) {
+    for (i = 0; i < info->nb_channels; i++) {
         if (adc_channel_setup(info->dev, &info->channels[i].cfg) != 0) {
             LOG_ERR("Failed to setup ADC channel %d", info->channels[i].id);
             return NULL;
         }
     }
- 
+
     alloc_size = sizeof(*adc) ;
 
+#ifdef CONFIG_MC_STATIC_ALLOC
+    adc = &adc_instance;
+#else
     adc = k_malloc(alloc_size);
+#endif
 
     if (adc)
     {
         memset(adc, 0, alloc_size);
 
         adc->info = info;
-        adc->callbacks = k_malloc(sizeof(void *) * info->nb_channels);
+        adc->current_aux = VOLTAGE_BUS;
 
-        memset(adc->callbacks, 0, sizeof(void *) * info->nb_channels);
+        adc->opts.interval_us = CONFIG_MC_ADC_SCAN_INTERVAL_US;
+        adc->opts.callback = adc_scan_sampling_done;
+        adc->opts.user_data = adc;
 
-        adc->tid = k_thread_create(&adc->thread, adc->thread_stack, sizeof(adc->thread_stack), adc_thread_entry, adc, NULL, NULL, 100, 0, K_FOREVER);
-        if (!adc->tid)
-        {
-            LOG_ERR("create thread err");
-            goto err;
-        }
+        adc->seq.options = &adc->opts;
+        adc->seq.buffer = adc->scan_buf;
+        adc->seq.oversampling = 0;
+        adc->seq.resolution = 12;
+
+        k_poll_signal_init(&adc->done_signal);
+        k_work_init(&adc->work, adc_dispatch_work);
+
+#ifdef CONFIG_SHELL
+        shell_adc = adc;
+#endif
     }
 
     return adc;
-err:
-    LOG_ERR("init err");
-    k_free(adc);
-    return NULL;
 }
 
 int adc_register_callback(struct adc_t *adc, struct adc_callback_t *cb)
-{        
+{
     struct adc_callback_t *callback;
 
-    if (adc)
+    if (adc && cb->id < ADC_CHANNEL_COUNT)
     {
         cb->next = NULL;
         callback = adc->callbacks[cb->id];
@@ -154,7 +366,155 @@ int adc_register_callback(struct adc_t *adc, struct adc_callback_t *cb)
     return -1;
 }
 
+int adc_register_scan_callback(struct adc_t *adc, struct adc_scan_callback_t *cb)
+{
+    struct adc_scan_callback_t *callback;
+
+    if (!adc || !cb)
+        return -1;
+
+    cb->next = NULL;
+
+    if (!adc->scan_callbacks)
+    {
+        adc->scan_callbacks = cb;
+        return 0;
+    }
+
+    for (callback = adc->scan_callbacks; callback->next; callback = callback->next)
+    {
+
+    }
+
+    callback->next = cb;
+
+    return 0;
+}
+
+int adc_register_stream(struct adc_t *adc, struct adc_stream_t *stream)
+{
+    struct adc_stream_t *last;
+
+    if (!adc || !stream || stream->id >= ADC_CHANNEL_COUNT || !stream->ring.buf)
+        return -EINVAL;
+
+    stream->next = NULL;
+
+    if (!adc->streams[stream->id])
+    {
+        adc->streams[stream->id] = stream;
+        return 0;
+    }
+
+    for (last = adc->streams[stream->id]; last->next; last = last->next)
+    {
+
+    }
+
+    last->next = stream;
+
+    return 0;
+}
+
+int adc_register_current_callback(struct adc_t *adc, struct adc_current_callback_t *cb)
+{
+    if (!adc || !cb)
+        return -EINVAL;
+
+    if (adc->current_cb)
+        return -EBUSY;
+
+    adc->current_cb = cb;
+
+#ifdef CONFIG_MC_ADC_CURRENT_INJECTED
+    /* phase currents leave the regular scan and move to the injected sequence */
+    adc->scan_exclude |= BIT(CURR_A) | BIT(CURR_C);
+#endif
+
+    return 0;
+}
+
+/*
+ * Route one more channel through the current path, e.g. the floating phase
+ * back-EMF. Safe from interrupt context; with injected sampling the new
+ * context is queued and takes effect on the next trigger, the sequence in
+ * progress completes with the old one.
+ */
+int adc_current_aux_select(struct adc_t *adc, uint8_t id)
+{
+#ifdef CONFIG_MC_ADC_CURRENT_INJECTED
+    int ret;
+#endif
+
+    if (!adc || id >= ADC_CHANNEL_COUNT)
+        return -EINVAL;
+
+    if (adc->current_aux == id)
+        return 0;
+
+#ifdef CONFIG_MC_ADC_CURRENT_INJECTED
+    ret = adc_current_context(adc, id);
+    if (ret)
+        return ret;
+#endif
+
+    adc->current_aux = id;
+
+    return 0;
+}
+
 void adc_start(struct adc_t *adc)
 {
-    k_thread_start(adc->tid);
-}
\ No newline at end of file
+    int ret;
+
+    adc_scan_setup(adc);
+
+    ret = adc_read_async(adc->info->dev, &adc->seq, &adc->done_signal);
+    if (ret)
+    {
+        LOG_ERR("start scan err:%d", ret);
+        return;
+    }
+
+#ifdef CONFIG_MC_ADC_CURRENT_INJECTED
+    if (adc->current_cb)
+    {
+        ret = adc_current_start(adc);
+        if (ret)
+        {
+            LOG_ERR("start current sampling err:%d", ret);
+        }
+    }
+#endif
+}
+
+#ifdef CONFIG_SHELL
+static int cmd_adc_streams(const struct shell *sh, size_t argc, char **argv)
+{
+    struct adc_stream_t *stream;
+    int id;
+
+    if (!shell_adc)
+        return -ENODEV;
+
+    shell_print(sh, "%-10s %3s %8s %8s", "stream", "ch", "pending", "overrun");
+
+    for (id = 0; id < ADC_CHANNEL_COUNT; id++)
+    {
+        for (stream = shell_adc->streams[id]; stream; stream = stream->next)
+        {
+            shell_print(sh, "%-10s %3d %8u %8u", stream->name ? stream->name : "-", id,
+                        (uint32_t)ring_count(&stream->ring), ring_overrun_get(&stream->ring));
+        }
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(adc_cmds,
+    SHELL_CMD(streams, NULL, "Show sample streams and their overruns", cmd_adc_streams),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(adc, &adc_cmds, "ADC sampling", NULL);
+#endif
@@ -0,0 +1,134 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <motor/angle.h>
+
+#include <math.h>
+
+#ifdef CONFIG_MC_SINCOS_CORDIC
+#include <stm32_ll_bus.h>
+#include <stm32_ll_cordic.h>
+#endif
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#include <stdlib.h>
+#endif
+
+LOG_MODULE_REGISTER(angle, LOG_LEVEL_INF);
+
+#define SINCOS_TABLE_BITS   CONFIG_MC_SINCOS_TABLE_BITS
+#define SINCOS_TABLE_SIZE   (1 << SINCOS_TABLE_BITS)
+#define SINCOS_FRAC_BITS    (16 - SINCOS_TABLE_BITS)
+#define SINCOS_FRAC_MASK    ((1 << SINCOS_FRAC_BITS) - 1)
+
+/* one full period plus a guard entry for the interpolation */
+static int16_t sin_table[SINCOS_TABLE_SIZE + 1];
+
+static inline int16_t angle_sin_lookup(uint16_t angle)
+{
+    uint16_t i = angle >> SINCOS_FRAC_BITS;
+    int32_t frac = angle & SINCOS_FRAC_MASK;
+    int32_t y0 = sin_table[i];
+
+    return y0 + (((sin_table[i + 1] - y0) * frac) >> SINCOS_FRAC_BITS);
+}
+
+void angle_sincos_table(uint16_t angle, int16_t *sin, int16_t *cos)
+{
+    *sin = angle_sin_lookup(angle);
+    *cos = angle_sin_lookup(angle + 0x4000);
+}
+
+#ifdef CONFIG_MC_SINCOS_CORDIC
+void angle_sincos_cordic(uint16_t angle, int16_t *sin, int16_t *cos)
+{
+    unsigned int key;
+    uint32_t res;
+
+    /* q1.15 angle in units of pi, modulus 1 in the upper half word */
+    key = irq_lock();
+    LL_CORDIC_WriteData(CORDIC, 0x7fff0000 | angle);
+    res = LL_CORDIC_ReadData(CORDIC);
+    irq_unlock(key);
+
+    *cos = (int16_t)(res & 0xffff);
+    *sin = (int16_t)(res >> 16);
+}
+#endif
+
+void fast_sincos(uint16_t angle, int16_t *sin, int16_t *cos)
+{
+#ifdef CONFIG_MC_SINCOS_CORDIC
+    angle_sincos_cordic(angle, sin, cos);
+#else
+    angle_sincos_table(angle, sin, cos);
+#endif
+}
+
+void angle_init(void)
+{
+    int i;
+
+    for (i = 0; i <= SINCOS_TABLE_SIZE; i++)
+    {
+        sin_table[i] = (int16_t)lroundf(sinf(2.0f * (float)M_PI * i / SINCOS_TABLE_SIZE) * 32767.0f);
+    }
+
+#ifdef CONFIG_MC_SINCOS_CORDIC
+    LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_CORDIC);
+    LL_CORDIC_Config(CORDIC, LL_CORDIC_FUNCTION_COSINE, LL_CORDIC_PRECISION_6CYCLES, LL_CORDIC_SCALE_0,
+                     LL_CORDIC_NBWRITE_1, LL_CORDIC_NBREAD_1, LL_CORDIC_INSIZE_16BITS, LL_CORDIC_OUTSIZE_16BITS);
+#endif
+}
+
+#ifdef CONFIG_SHELL
+#define ANGLE_BENCH_STEP    7
+
+static void angle_bench_run(const struct shell *sh, const char *name, void (*func)(uint16_t, int16_t *, int16_t *))
+{
+    volatile int16_t sink;
+    int16_t s, c;
+    int32_t err, err_max = 0;
+    uint32_t start, cycles, n = 0;
+    float theta;
+    int i;
+
+    for (i = 0; i < 65536; i += ANGLE_BENCH_STEP)
+    {
+        func(i, &s, &c);
+        theta = 2.0f * (float)M_PI * i / 65536.0f;
+        err = abs(s - (int32_t)lroundf(sinf(theta) * 32767.0f));
+        err_max = MAX(err_max, err);
+        err = abs(c - (int32_t)lroundf(cosf(theta) * 32767.0f));
+        err_max = MAX(err_max, err);
+    }
+
+    start = k_cycle_get_32();
+    for (i = 0; i < 65536; i += ANGLE_BENCH_STEP, n++)
+    {
+        func(i, &s, &c);
+        sink = s + c;
+    }
+    cycles = k_cycle_get_32() - start;
+    (void)sink;
+
+    shell_print(sh, "%-8s max err %d LSB, %u cycles/call", name, err_max, cycles / n);
+}
+
+static int cmd_angle_bench(const struct shell *sh, size_t argc, char **argv)
+{
+    angle_bench_run(sh, "table", angle_sincos_table);
+#ifdef CONFIG_MC_SINCOS_CORDIC
+    angle_bench_run(sh, "cordic", angle_sincos_cordic);
+#endif
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(angle_cmds,
+    SHELL_CMD(bench, NULL, "Compare accuracy and cost of the sin/cos backends", cmd_angle_bench),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(angle, &angle_cmds, "Rotor angle helpers", NULL);
+#endif
@@ -0,0 +1,322 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <motor/bldc.h>
+#include <motor/svpwm.h>
+#include <motor/adc.h>
+#include <motor/mc.h>
+#include <motor/motor.h>
+
+#include <string.h>
+
+LOG_MODULE_REGISTER(bldc, LOG_LEVEL_INF);
+
+#define BLDC_ALARM_CHANNEL  0
+/* consecutive samples past the threshold before a crossing is accepted */
+#define BLDC_ZC_FILTER      2
+
+struct bldc_step {
+    uint8_t high;
+    uint8_t low;
+    uint8_t floating;
+    bool rising;
+};
+
+/* phase index is both the svpwm channel and the BEMF_A..BEMF_C channel id */
+static const struct bldc_step bldc_steps[6] = {
+    { 0, 1, 2, false },
+    { 0, 2, 1, true },
+    { 1, 2, 0, false },
+    { 1, 0, 2, true },
+    { 2, 0, 1, false },
+    { 2, 1, 0, true },
+};
+
+static uint32_t bldc_now(struct bldc_t *bldc)
+{
+    uint32_t ticks = 0;
+
+    counter_get_value(bldc->timer, &ticks);
+
+    return ticks;
+}
+
+static void bldc_alarm_set(struct bldc_t *bldc, uint32_t ticks)
+{
+    bldc->alarm.ticks = MAX(ticks, 1);
+    counter_set_channel_alarm(bldc->timer, BLDC_ALARM_CHANNEL, &bldc->alarm);
+}
+
+/*
+ * The back-EMF is sampled at the carrier center, the middle of the high
+ * side pulse, after the two current ranks. Short pulses are stretched so
+ * the floating phase is still driven against the bus when it is sampled.
+ */
+static uint32_t bldc_pulse(struct bldc_t *bldc)
+{
+    uint32_t period = svpwm_period_get(bldc->svpwm);
+    uint32_t pulse = ((uint32_t)bldc->duty * period) >> 15;
+
+    return CLAMP(pulse, MIN(bldc->pulse_min, period), period);
+}
+
+static void bldc_apply(struct bldc_t *bldc)
+{
+    const struct bldc_step *s = &bldc_steps[bldc->step];
+    const struct mc_adc_info *bemf = &bldc->adc[s->floating];
+    int64_t half_bus = bldc->adc[VOLTAGE_BUS].value / 2;
+
+    svpwm_channel_enable(bldc->svpwm, s->floating, false);
+    svpwm_update_pulse(bldc->svpwm, s->floating, 0);
+    svpwm_update_pulse(bldc->svpwm, s->low, 0);
+    svpwm_update_pulse(bldc->svpwm, s->high, bldc_pulse(bldc));
+    svpwm_channel_enable(bldc->svpwm, s->low, true);
+    svpwm_channel_enable(bldc->svpwm, s->high, true);
+
+    /* during the ON time the floating phase sits at vbus / 2 + bemf */
+    if (bemf->calib.gain)
+        bldc->threshold = ((half_bus << MC_ADC_GAIN_SHIFT) / bemf->calib.gain) + bemf->calib.offset;
+
+    mc_current_aux_select(bldc->mc, s->floating);
+
+    bldc->zc_filter = 0;
+    bldc->zc_seen = false;
+}
+
+static void bldc_commutate(struct bldc_t *bldc, uint32_t now)
+{
+    bldc->step = (bldc->step + 1) % ARRAY_SIZE(bldc_steps);
+    bldc->commutated_at = now;
+    bldc_apply(bldc);
+}
+
+static void bldc_off(struct bldc_t *bldc)
+{
+    bldc->mode = BLDC_MODE_OFF;
+    counter_cancel_channel_alarm(bldc->timer, BLDC_ALARM_CHANNEL);
+    svpwm_enable(bldc->svpwm, false);
+}
+
+/* forced step period of the open-loop ramp, linear in electrical frequency */
+static uint32_t bldc_ramp_period(struct bldc_t *bldc)
+{
+    uint32_t hz = CONFIG_MC_BLDC_RAMP_END_HZ;
+
+    if (bldc->ramp_elapsed < bldc->ramp_ticks)
+    {
+        hz = CONFIG_MC_BLDC_RAMP_START_HZ +
+             (uint64_t)(CONFIG_MC_BLDC_RAMP_END_HZ - CONFIG_MC_BLDC_RAMP_START_HZ) * bldc->ramp_elapsed / bldc->ramp_ticks;
+    }
+
+    return bldc->timer_freq / (6 * hz);
+}
+
+static void bldc_zero_cross(struct bldc_t *bldc, uint32_t now)
+{
+    uint32_t interval = now - bldc->last_zc;
+
+    bldc->last_zc = now;
+
+    if (bldc->mode == BLDC_MODE_RAMP)
+    {
+        if (++bldc->sync_count < CONFIG_MC_BLDC_SYNC_STEPS || bldc->ramp_elapsed < bldc->ramp_ticks)
+            return;
+
+        /* hand over from the forced ramp, keep its step period as the estimate */
+        bldc->mode = BLDC_MODE_CLOSED_LOOP;
+        k_event_post(bldc->event, MOTOR_EVENT_SYNC);
+    } else {
+        bldc->step_ticks = (3 * bldc->step_ticks + interval) / 4;
+    }
+
+    /* commutate 30 degrees, half a step, after the crossing */
+    counter_cancel_channel_alarm(bldc->timer, BLDC_ALARM_CHANNEL);
+    bldc_alarm_set(bldc, bldc->step_ticks / 2);
+}
+
+static void bldc_alarm_handler(const struct device *dev, uint8_t chan_id, uint32_t ticks, void *user_data)
+{
+    struct bldc_t *bldc = user_data;
+    k_spinlock_key_t key = k_spin_lock(&bldc->lock);
+
+    switch (bldc->mode)
+    {
+        case BLDC_MODE_RAMP:
+            if (!bldc->zc_seen)
+                bldc->sync_count = 0;
+            bldc_commutate(bldc, ticks);
+            bldc->ramp_elapsed += bldc->step_ticks;
+            bldc->step_ticks = bldc_ramp_period(bldc);
+            bldc_alarm_set(bldc, bldc->step_ticks);
+            break;
+        case BLDC_MODE_CLOSED_LOOP:
+            if (!bldc->zc_seen)
+            {
+                /* no crossing for two steps, the rotor lost sync */
+                bldc_off(bldc);
+                k_event_post(bldc->event, MOTOR_EVENT_STALL);
+                break;
+            }
+            bldc_commutate(bldc, ticks);
+            /* stall watchdog, re-armed by the next crossing */
+            bldc_alarm_set(bldc, 2 * bldc->step_ticks);
+            break;
+        default:
+            break;
+    }
+
+    k_spin_unlock(&bldc->lock, key);
+}
+
+/* called from the PWM-synchronized ADC interrupt with the floating phase sample */
+void bldc_bemf_update(struct bldc_t *bldc, uint16_t bemf)
+{
+    const struct bldc_step *s;
+    k_spinlock_key_t key;
+    uint32_t now;
+    bool above;
+
+    if (bldc->mode != BLDC_MODE_RAMP && bldc->mode != BLDC_MODE_CLOSED_LOOP)
+        return;
+
+    key = k_spin_lock(&bldc->lock);
+
+    s = &bldc_steps[bldc->step];
+    now = bldc_now(bldc);
+
+    /* one crossing per step, and skip the demagnetization tail */
+    if (bldc->zc_seen || now - bldc->commutated_at < bldc->step_ticks / 4)
+        goto out;
+
+    above = bemf > bldc->threshold;
+    if (above != s->rising)
+    {
+        bldc->zc_filter = 0;
+        goto out;
+    }
+
+    if (++bldc->zc_filter < BLDC_ZC_FILTER)
+        goto out;
+
+    bldc->zc_seen = true;
+    bldc_zero_cross(bldc, now);
+
+out:
+    k_spin_unlock(&bldc->lock, key);
+}
+
+int bldc_init(struct bldc_t *bldc, const struct device *timer, struct svpwm_t *svpwm,
+              struct mc_t *mc, const struct mc_adc_info *adc, struct k_event *event)
+{
+    int ret;
+
+    if (!timer || !svpwm || !adc || !event)
+        return -EINVAL;
+
+    if (!device_is_ready(timer))
+    {
+        LOG_ERR("commutation timer not ready");
+        return -ENODEV;
+    }
+
+    /* step intervals are computed with wrapping 32-bit arithmetic */
+    if (counter_get_top_value(timer) != UINT32_MAX)
+    {
+        LOG_ERR("%s is not a free running 32-bit counter", timer->name);
+        return -ENOTSUP;
+    }
+
+    memset(bldc, 0, sizeof(*bldc));
+    bldc->timer = timer;
+    bldc->svpwm = svpwm;
+    bldc->mc = mc;
+    bldc->adc = adc;
+    bldc->event = event;
+    bldc->timer_freq = counter_get_frequency(timer);
+    bldc->ramp_ticks = (uint64_t)bldc->timer_freq * CONFIG_MC_BLDC_RAMP_MS / 1000;
+
+    bldc->alarm.callback = bldc_alarm_handler;
+    bldc->alarm.user_data = bldc;
+    bldc->alarm.flags = 0;
+
+    ret = counter_start(timer);
+    if (ret && ret != -EALREADY)
+    {
+        LOG_ERR("start commutation timer err:%d", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+/* energize the first step to pull the rotor to a known position */
+int bldc_start(struct bldc_t *bldc, uint16_t duty)
+{
+    k_spinlock_key_t key;
+
+    if (!bldc->timer)
+        return -ENODEV;
+
+    key = k_spin_lock(&bldc->lock);
+
+    /* in timer cycles, half of the pulse lies on each side of the center */
+    bldc->pulse_min = (uint64_t)svpwm_period_get(bldc->svpwm) * svpwm_freq_get(bldc->svpwm) *
+                      2 * CONFIG_MC_BLDC_BEMF_ON_NS / NSEC_PER_SEC;
+    bldc->mode = BLDC_MODE_ALIGN;
+    bldc->duty = duty;
+    bldc->step = 0;
+    bldc->commutated_at = bldc_now(bldc);
+    bldc_apply(bldc);
+
+    k_spin_unlock(&bldc->lock, key);
+
+    return 0;
+}
+
+void bldc_ramp_start(struct bldc_t *bldc)
+{
+    k_spinlock_key_t key;
+    uint32_t now;
+
+    if (!bldc->timer)
+        return;
+
+    key = k_spin_lock(&bldc->lock);
+
+    now = bldc_now(bldc);
+
+    bldc->mode = BLDC_MODE_RAMP;
+    bldc->sync_count = 0;
+    bldc->ramp_elapsed = 0;
+    bldc->last_zc = now;
+    bldc->step_ticks = bldc_ramp_period(bldc);
+
+    bldc_commutate(bldc, now);
+    bldc_alarm_set(bldc, bldc->step_ticks);
+
+    k_spin_unlock(&bldc->lock, key);
+}
+
+void bldc_stop(struct bldc_t *bldc)
+{
+    k_spinlock_key_t key;
+
+    if (!bldc->timer)
+        return;
+
+    key = k_spin_lock(&bldc->lock);
+    bldc_off(bldc);
+    k_spin_unlock(&bldc->lock, key);
+}
+
+/* electrical rpm from the filtered step interval */
+uint32_t bldc_speed_get(struct bldc_t *bldc)
+{
+    uint32_t step_ticks = bldc->step_ticks;
+
+    if (bldc->mode < BLDC_MODE_RAMP || !step_ticks)
+        return 0;
+
+    /* 60 s/min over 6 steps per electrical revolution */
+    return (uint64_t)bldc->timer_freq * 10 / step_ticks;
+}
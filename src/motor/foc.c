@@ -0,0 +1,157 @@
+#include <zephyr/kernel.h>
+
+#include <motor/foc.h>
+#include <motor/angle.h>
+#include <motor/prof.h>
+
+#include <string.h>
+
+#define Q15_ONE             32767
+#define Q15_INV_SQRT3       18919   /* 1/sqrt(3) */
+#define Q15_SQRT3_2         28378   /* sqrt(3)/2 */
+#define Q15_HALF            16384
+
+/* limit of the linear SVPWM region, 1/sqrt(3) of the bus voltage */
+#define FOC_VOLTAGE_MAX     Q15_INV_SQRT3
+
+static inline int16_t sat16(int32_t v)
+{
+    if (v > INT16_MAX)
+        return INT16_MAX;
+    if (v < INT16_MIN)
+        return INT16_MIN;
+    return v;
+}
+
+static inline int32_t clamp32(int32_t v, int32_t min, int32_t max)
+{
+    return v < min ? min : (v > max ? max : v);
+}
+
+/* 12-bit reading around its zero current offset, saturated to Q15 */
+int16_t foc_current_q15(uint16_t raw, int32_t offset)
+{
+    return sat16(((int32_t)raw - offset) << 4);
+}
+
+void foc_clarke(int16_t ia, int16_t ic, int16_t *alpha, int16_t *beta)
+{
+    /* ib = -ia - ic, beta = (ia + 2 * ib) / sqrt(3) */
+    *alpha = ia;
+    *beta = sat16(((-(int32_t)ia - 2 * (int32_t)ic) * Q15_INV_SQRT3) >> 15);
+}
+
+void foc_park(int16_t alpha, int16_t beta, int16_t sin, int16_t cos, int16_t *d, int16_t *q)
+{
+    *d = sat16(((int32_t)alpha * cos + (int32_t)beta * sin) >> 15);
+    *q = sat16(((int32_t)beta * cos - (int32_t)alpha * sin) >> 15);
+}
+
+void foc_inv_park(int16_t d, int16_t q, int16_t sin, int16_t cos, int16_t *alpha, int16_t *beta)
+{
+    *alpha = sat16(((int32_t)d * cos - (int32_t)q * sin) >> 15);
+    *beta = sat16(((int32_t)d * sin + (int32_t)q * cos) >> 15);
+}
+
+/*
+ * Min-max (center) injection: shifting the three phase voltages by the
+ * mean of the largest and smallest one gives the same switching pattern
+ * as sector based SVPWM. Returns the sector, 1..6, or 0 for a zero vector
+ * whose three phase voltages are equal.
+ */
+uint8_t foc_svpwm(int16_t alpha, int16_t beta, uint16_t duty[3])
+{
+    int32_t v[3], vmax, vmin, offset;
+    uint8_t imax = 0, imin = 0;
+    int i;
+
+    /* rows: max phase, columns: min phase */
+    static const uint8_t sector_map[3][3] = {
+        { 0, 6, 1 },
+        { 3, 0, 2 },
+        { 4, 5, 0 },
+    };
+
+    v[0] = alpha;
+    v[1] = (-(int32_t)alpha * Q15_HALF + (int32_t)beta * Q15_SQRT3_2) >> 15;
+    v[2] = (-(int32_t)alpha * Q15_HALF - (int32_t)beta * Q15_SQRT3_2) >> 15;
+
+    vmax = vmin = v[0];
+    for (i = 1; i < 3; i++)
+    {
+        if (v[i] > vmax)
+        {
+            vmax = v[i];
+            imax = i;
+        }
+        if (v[i] < vmin)
+        {
+            vmin = v[i];
+            imin = i;
+        }
+    }
+
+    offset = Q15_HALF - ((vmax + vmin) >> 1);
+
+    for (i = 0; i < 3; i++)
+    {
+        duty[i] = clamp32(v[i] + offset, 0, Q15_ONE);
+    }
+
+    return sector_map[imax][imin];
+}
+
+int16_t foc_pi_run(struct foc_pi *pi, int16_t err)
+{
+    int32_t p, out;
+
+    pi->integral = clamp32(pi->integral + pi->ki * err,
+                           (int32_t)pi->out_min << FOC_PI_SHIFT,
+                           (int32_t)pi->out_max << FOC_PI_SHIFT);
+
+    p = (pi->kp * err) >> FOC_PI_SHIFT;
+    out = p + (pi->integral >> FOC_PI_SHIFT);
+
+    return clamp32(out, pi->out_min, pi->out_max);
+}
+
+void foc_reset(struct foc_t *foc)
+{
+    foc->pi_d.integral = 0;
+    foc->pi_q.integral = 0;
+    foc->id_ref = 0;
+    foc->iq_ref = 0;
+    foc->duty[0] = foc->duty[1] = foc->duty[2] = Q15_HALF;
+}
+
+void foc_init(struct foc_t *foc, int32_t kp, int32_t ki)
+{
+    memset(foc, 0, sizeof(*foc));
+
+    foc->pi_d.kp = foc->pi_q.kp = kp;
+    foc->pi_d.ki = foc->pi_q.ki = ki;
+    foc->pi_d.out_min = foc->pi_q.out_min = -FOC_VOLTAGE_MAX;
+    foc->pi_d.out_max = foc->pi_q.out_max = FOC_VOLTAGE_MAX;
+
+    foc_reset(foc);
+}
+
+/* one current loop period, straight-line code with a fixed cost */
+void foc_step(struct foc_t *foc, int16_t ia, int16_t ic, uint16_t angle)
+{
+    PROF_START(start);
+    int16_t sin, cos;
+
+    fast_sincos(angle, &sin, &cos);
+
+    foc_clarke(ia, ic, &foc->i_alpha, &foc->i_beta);
+    foc_park(foc->i_alpha, foc->i_beta, sin, cos, &foc->i_d, &foc->i_q);
+
+    foc->v_d = foc_pi_run(&foc->pi_d, sat16((int32_t)foc->id_ref - foc->i_d));
+    foc->v_q = foc_pi_run(&foc->pi_q, sat16((int32_t)foc->iq_ref - foc->i_q));
+
+    foc_inv_park(foc->v_d, foc->v_q, sin, cos, &foc->v_alpha, &foc->v_beta);
+    foc->sector = foc_svpwm(foc->v_alpha, foc->v_beta, foc->duty);
+
+    PROF_STOP(PROF_FOC_STEP, start);
+}
@@ -5,9 +5,13 @@
 #include <motor/svpwm.h>
 #include <motor/adc.h>
 #include <motor/motor.h>
+#include <motor/angle.h>
+#include <motor/prof.h>
 
 #include <menu/menu.h>
 
+#include <stdlib.h>
+
 struct mc_t {
     struct motor_t **motors;
     int nb_motor;
@@ -17,14 +21,51 @@ struct mc_t {
         uint32_t voltage_max;
     } motor;
     struct menu_t *menu;
-    struct mc_adc_info adc_info[6];
+    struct mc_adc_info adc_info[ADC_CHANNEL_COUNT];
+    /* channels of the ADC configuration, only those can publish */
+    uint32_t channels;
+    struct adc_current_callback_t current_cb;
+    struct k_work current_work;
+    uint16_t current_div;
+    struct {
+        uint32_t sum_a;
+        uint32_t sum_c;
+        uint16_t count;
+    } calib;
+};
+
+#define MC_ADC_VREF_MV          3300.0f
+#define MC_ADC_FULL_SCALE       4095.0f
+#define MC_ADC_MID_SCALE        2048
+#define MC_CURRENT_SPAN_MA      60000.0f
+#define MC_CURRENT_CALIB_SAMPLES 1024
+
+/* physical scaling of each channel, turned into integer gains at init */
+static const struct {
+    float units_per_count;
+    int32_t offset;
+} mc_adc_scale[ADC_CHANNEL_COUNT] = {
+    [BEMF_A] = { MC_ADC_VREF_MV / MC_ADC_FULL_SCALE * 11.0f, 0 },
+    [BEMF_B] = { MC_ADC_VREF_MV / MC_ADC_FULL_SCALE * 11.0f, 0 },
+    [BEMF_C] = { MC_ADC_VREF_MV / MC_ADC_FULL_SCALE * 11.0f, 0 },
+    [VOLTAGE_BUS] = { MC_ADC_VREF_MV / MC_ADC_FULL_SCALE * (104.7f / 4.7f), 0 },
+    [CURR_A] = { MC_CURRENT_SPAN_MA / MC_ADC_FULL_SCALE, MC_ADC_MID_SCALE },
+    [CURR_C] = { MC_CURRENT_SPAN_MA / MC_ADC_FULL_SCALE, MC_ADC_MID_SCALE },
+    [SPEED_VALUE] = { 1.0f, 0 },
 };
 
 LOG_MODULE_REGISTER(mc, LOG_LEVEL_INF);
 
+#ifdef CONFIG_MC_STATIC_ALLOC
+static struct mc_t mc_instance;
+static struct motor_t *mc_motors[CONFIG_MC_MAX_MOTORS];
+#endif
+
 static bool mc_motor_voltage_check(struct mc_t *mc)
 {
-    if (mc->adc_info[VOLTAGE_BUS].value > mc->motor.voltage_max || mc->adc_info[VOLTAGE_BUS].value < mc->motor.voltage_min)
+    int32_t vbus = mc->adc_info[VOLTAGE_BUS].value;
+
+    if (vbus > (int32_t)mc->motor.voltage_max || vbus < (int32_t)mc->motor.voltage_min)
     {
         return false;
     }
@@ -38,10 +79,37 @@ void mc_motor_voltage_range_set(struct mc_t *mc, int min, int max)
     mc->motor.voltage_max = max;
 }
 
+static inline int32_t mc_adc_convert(const struct mc_adc_calib *calib, int32_t raw)
+{
+    return ((int64_t)(raw - calib->offset) * calib->gain) >> MC_ADC_GAIN_SHIFT;
+}
+
+static void mc_value_publish(struct mc_adc_info *info)
+{
+    uint32_t now = k_uptime_get_32();
+    struct mc_value_sub *sub;
+
+    for (sub = info->subs; sub; sub = sub->next)
+    {
+        if (sub->published)
+        {
+            if (abs(info->value - sub->last_value) < sub->threshold)
+                continue;
+            if (now - sub->last_ms < sub->interval_ms)
+                continue;
+        }
+
+        sub->published = true;
+        sub->last_value = info->value;
+        sub->last_ms = now;
+        sub->notify(sub, info->value);
+    }
+}
+
 static void mc_adc_callback_entry(struct adc_callback_t *self, uint16_t *values, size_t count, void *param)
 {
+    PROF_START(start);
     struct mc_adc_info *info = CONTAINER_OF(self, struct mc_adc_info, cb);
-    double value = 0.0;
     uint32_t sum = 0;
     count = count / sizeof(uint16_t);
     int i;
@@ -51,47 +119,114 @@ static void mc_adc_callback_entry(struct adc_callback_t *self, uint16_t *values,
         sum += values[i];
     }
 
-    value = (double)(sum / count);
+    info->raw_value = sum / count;
+    info->value = mc_adc_convert(&info->calib, info->raw_value);
+
+    PROF_STOP(PROF_ADC_CALLBACK, start);
+
+    mc_value_publish(info);
+}
+
+static void mc_current_callback_entry(struct adc_current_callback_t *self, const struct adc_current_samples *samples, void *param)
+{
+    struct mc_t *mc = param;
+    int i;
+
+    mc->adc_info[CURR_A].raw_value = samples->curr_a;
+    mc->adc_info[CURR_C].raw_value = samples->curr_c;
+
+    if (mc->calib.count < MC_CURRENT_CALIB_SAMPLES)
+    {
+        mc->calib.sum_a += samples->curr_a;
+        mc->calib.sum_c += samples->curr_c;
+        if (++mc->calib.count == MC_CURRENT_CALIB_SAMPLES)
+        {
+            mc->adc_info[CURR_A].calib.offset = mc->calib.sum_a / MC_CURRENT_CALIB_SAMPLES;
+            mc->adc_info[CURR_C].calib.offset = mc->calib.sum_c / MC_CURRENT_CALIB_SAMPLES;
+        }
+        return;
+    }
+
+    mc->adc_info[CURR_A].value = mc_adc_convert(&mc->adc_info[CURR_A].calib, samples->curr_a);
+    mc->adc_info[CURR_C].value = mc_adc_convert(&mc->adc_info[CURR_C].calib, samples->curr_c);
+
+    for (i = 0; i < mc->nb_motor; i++)
+    {
+        motor_current_update(mc->motors[i], samples);
+    }
 
-    info->raw_value =  value;
+    if (!mc->adc_info[CURR_A].subs && !mc->adc_info[CURR_C].subs)
+        return;
 
-    switch(self->id)
+    if (++mc->current_div >= CONFIG_MC_CURRENT_PUBLISH_DIV)
     {
-        case VOLTAGE_BUS:
-            info->value = ((float)value / 4095.0f) * 3.3f * (104.7f / 4.7f);
-            break;
-        case CURR_A:
-        case CURR_C:
-            info->value = 60.0f * (((float)value / 4095.0f) - 0.5f);
-            break;
-        case BEMF_A:
-        case BEMF_B:
-        case BEMF_C:
-            info->value = ((float)value / 4095.0f) * 3.3f * 11.0f;
-            break;
+        mc->current_div = 0;
+        k_work_submit(&mc->current_work);
     }
 }
 
+/* the latest phase currents, once every MC_CURRENT_PUBLISH_DIV samples */
+static void mc_current_publish_work(struct k_work *work)
+{
+    struct mc_t *mc = CONTAINER_OF(work, struct mc_t, current_work);
+
+    mc_value_publish(&mc->adc_info[CURR_A]);
+    mc_value_publish(&mc->adc_info[CURR_C]);
+}
+
 struct mc_t *mc_init(uint8_t type, int nb_motor)
 {
     int i;
-    struct mc_t *mc = k_malloc(sizeof(*mc));
+    struct mc_t *mc;
 
+#ifdef CONFIG_MC_STATIC_ALLOC
+    if (nb_motor > CONFIG_MC_MAX_MOTORS)
+    {
+        LOG_ERR("%d motors requested, %d reserved", nb_motor, CONFIG_MC_MAX_MOTORS);
+        return NULL;
+    }
+
+    mc = &mc_instance;
+    memset(mc, 0, sizeof(*mc));
+    mc->motors = mc_motors;
+#else
+    mc = k_malloc(sizeof(*mc));
+    if (!mc)
+        return NULL;
+
+    memset(mc, 0, sizeof(*mc));
     mc->motors = k_malloc(sizeof(void *) * nb_motor);
+    if (!mc->motors)
+    {
+        k_free(mc);
+        return NULL;
+    }
+#endif
 
-    memset(mc->adc_info, 0, sizeof(mc->adc_info));
+    angle_init();
 
     for (i = 0; i < nb_motor; i++)
     {
         mc->motors[i] = motor_init(mc, mc->adc_info,  type, i);
+        if (!mc->motors[i])
+        {
+            LOG_ERR("motor %d init failed", i);
+            return NULL;
+        }
     }
 
-    for (i = 0; i < 6; i++)
+    for (i = 0; i < ADC_CHANNEL_COUNT; i++)
     {
         mc->adc_info[i].cb.func = mc_adc_callback_entry;
         mc->adc_info[i].cb.id = i;
+        mc->adc_info[i].calib.offset = mc_adc_scale[i].offset;
+        mc->adc_info[i].calib.gain = (int32_t)(mc_adc_scale[i].units_per_count * (1 << MC_ADC_GAIN_SHIFT) + 0.5f);
     }
 
+    mc->current_cb.func = mc_current_callback_entry;
+    mc->current_cb.param = mc;
+    k_work_init(&mc->current_work, mc_current_publish_work);
+
     mc->nb_motor = nb_motor;
 
 
@@ -110,21 +245,36 @@ int mc_svpwm_init(struct mc_t *mc, const struct svpwm_info *info, int motor_id)
     return ret;
 }
 
+int mc_bldc_init(struct mc_t *mc, const struct device *timer, int motor_id)
+{
+    if (motor_id >= mc->nb_motor)
+        return -EINVAL;
+
+    return motor_bldc_init(mc->motors[motor_id], timer);
+}
+
 int mc_adc_init(struct mc_t *mc, const struct adc_info *info)
 {
-    // int i;
+    uint8_t id;
+    int i;
+
     mc->adc = adc_init(info);
 
-    if (mc->adc)
-        adc_register_callback(mc->adc, &mc->adc_info[VOLTAGE_BUS].cb);
+    if (!mc->adc)
+        return -ENODEV;
 
-    // if (mc->adc)
-    // {
-    //     for (i = 0; i < 6; i++)
-    //         adc_register_callback(mc->adc, &mc->adc_info[i].cb);
-    // }
+    adc_register_current_callback(mc->adc, &mc->current_cb);
 
-    return mc->adc ? 0 : -ENODEV;
+    /* every channel but the phase currents is averaged in the callback work */
+    for (i = 0; i < info->nb_channels; i++)
+    {
+        id = info->channels[i].id;
+        mc->channels |= BIT(id);
+        if (id != CURR_A && id != CURR_C)
+            adc_register_callback(mc->adc, &mc->adc_info[id].cb);
+    }
+
+    return 0;
 }
 
 int mc_adc_event_register(struct mc_t *mc, struct adc_callback_t *cb)
@@ -132,11 +282,30 @@ int mc_adc_event_register(struct mc_t *mc, struct adc_callback_t *cb)
     return adc_register_callback(mc->adc, cb);
 }
 
+int mc_adc_stream_register(struct mc_t *mc, struct adc_stream_t *stream)
+{
+    return adc_register_stream(mc->adc, stream);
+}
+
 void mc_adc_start(struct mc_t *mc)
 {
+    mc_current_calibrate(mc);
     adc_start(mc->adc);
 }
 
+/* re-measure the current sensor zero offsets, the power stage must be off */
+void mc_current_calibrate(struct mc_t *mc)
+{
+    mc->calib.sum_a = 0;
+    mc->calib.sum_c = 0;
+    mc->calib.count = 0;
+}
+
+int mc_current_aux_select(struct mc_t *mc, uint8_t id)
+{
+    return adc_current_aux_select(mc->adc, id);
+}
+
 struct motor_t *mc_motor_get(struct mc_t *mc, uint8_t id)
 {
     if (id > mc->nb_motor)
@@ -175,11 +344,32 @@ bool mc_motor_ready(struct mc_t *mc, bool is_ready)
     return true;
 }
 
-double mc_vbus_get(struct mc_t *mc)
+int32_t mc_vbus_get(struct mc_t *mc)
 {
     return mc->adc_info[VOLTAGE_BUS].value;
 }
 
+/*
+ * Channels of the ADC configuration publish from the ADC callback work, the
+ * phase currents from a work item fed every MC_CURRENT_PUBLISH_DIV samples.
+ * -ENOTSUP for a channel the ADC does not convert. Subscribe after
+ * mc_adc_init() and before mc_adc_start().
+ */
+int mc_value_subscribe(struct mc_t *mc, struct mc_value_sub *sub)
+{
+    if (!sub || !sub->notify || sub->channel >= ADC_CHANNEL_COUNT)
+        return -EINVAL;
+
+    if (!(mc->channels & BIT(sub->channel)))
+        return -ENOTSUP;
+
+    sub->published = false;
+    sub->next = mc->adc_info[sub->channel].subs;
+    mc->adc_info[sub->channel].subs = sub;
+
+    return 0;
+}
+
 void mc_menu_bind(struct menu_t *menu, struct mc_t *mc)
 {
     mc->menu = menu;
@@ -77,7 +77,7 @@ struct menu_item_t motor_speed_item = {
 
 const char *motor_type_options[] = {
     "BLDC",
-    "DC",
+    "FOC",
 };
 
 static struct menu_item_t motor_type_item = {
@@ -133,23 +133,38 @@ static void motor_voltage_range_set_cb(struct menu_item_t *item, int32_t min, in
     mc_motor_voltage_range_set(menu_driver_get(item->menu), min, max);
 }
 
+#define SPEED_STREAM_SIZE       128
+#define SPEED_DRAIN_PERIOD_MS   50
+
+static uint16_t speed_stream_buf[SPEED_STREAM_SIZE];
+static struct adc_stream_t speed_stream = {
+    .name = "speed",
+    .id = SPEED_VALUE,
+};
+
 static void speed_item_value_change_work(struct k_work *work)
 {
-    struct item_input_t *input = CONTAINER_OF(work, struct item_input_t, work);
-    uint32_t batch_avg = 0;
-    size_t count = input->values_count / sizeof(uint16_t);
-
-    if (count > 0) {
-        for (int i = 0; i < count; i++) {
-            batch_avg += input->values[i];
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct item_input_t *input = CONTAINER_OF(dwork, struct item_input_t, work);
+    uint16_t values[32];
+    uint32_t batch_sum = 0;
+    size_t count = 0;
+    size_t n;
+    int i;
+
+    while ((n = ring_get(&speed_stream.ring, values, ARRAY_SIZE(values))) > 0) {
+        for (i = 0; i < n; i++) {
+            batch_sum += values[i];
         }
-        batch_avg /= count;
+        count += n;
+    }
 
-        input->filter_window[input->filter_index] = batch_avg;
+    if (count > 0) {
+        input->filter_window[input->filter_index] = batch_sum / count;
         input->filter_index = (input->filter_index + 1) % ADC_FILTER_WINDOW_SIZE;
 
         uint32_t filtered_avg = 0;
-        for (int i = 0; i < ADC_FILTER_WINDOW_SIZE; i++) {
+        for (i = 0; i < ADC_FILTER_WINDOW_SIZE; i++) {
             filtered_avg += input->filter_window[i];
         }
         filtered_avg /= ADC_FILTER_WINDOW_SIZE;
@@ -158,39 +173,36 @@ static void speed_item_value_change_work(struct k_work *work)
 
         input->live_value = new_rpm;
     }
+
+    k_work_schedule(dwork, K_MSEC(SPEED_DRAIN_PERIOD_MS));
 }
 
-static void speed_item_value_change_func(struct adc_callback_t *self, uint16_t *values, size_t count, void *param)
+static void motor_menu_add(struct menu_group_t *group, struct menu_item_t *item)
 {
-    struct menu_item_t *item = param;
-    item->input.values = values;
-    item->input.values_count = count;
+    int ret = menu_group_add_item(group, item);
 
-    k_work_submit(&item->input.work);
+    if (ret)
+        LOG_ERR("add item %s (id %d) err:%d", item->name, item->id, ret);
 }
 
 void mc_setup_menu_bind(struct mc_t *mc, struct menu_t *menu)
 {
     struct menu_group_t *motor_group;
-    static struct adc_callback_t speed_event_callback = {
-        .func = speed_item_value_change_func,
-        .id = SPEED_VALUE,
-    };
 
     motor_group = menu_group_create(menu, "Motor", 0, 5, 160, 75, COLOR_WHITE, MENU_LAYOUT_VERTICAL | MENU_ALIGN_V_CENTER, 0);
 
-    k_work_init(&motor_speed_item.input.work, speed_item_value_change_work);
+    k_work_init_delayable(&motor_speed_item.input.work, speed_item_value_change_work);
 
 
-    menu_group_add_item(motor_group, &motor_speed_item);
-    menu_group_add_item(motor_group, &motor_type_item);
-    menu_group_add_item(motor_group, &motor_voltage_item);
+    motor_menu_add(motor_group, &motor_speed_item);
+    motor_menu_add(motor_group, &motor_type_item);
+    motor_menu_add(motor_group, &motor_voltage_item);
 
     menu_group_bind_item(motor_group, &setup_motor_item);
 
-    speed_event_callback.param = &motor_speed_item;
-
-    mc_adc_event_register(mc, &speed_event_callback);
+    ring_init(&speed_stream.ring, speed_stream_buf, SPEED_STREAM_SIZE);
+    mc_adc_stream_register(mc, &speed_stream);
+    k_work_schedule(&motor_speed_item.input.work, K_MSEC(SPEED_DRAIN_PERIOD_MS));
 
-    menu_group_add_item(motor_group, &motor_pwm_freq_item);
+    motor_menu_add(motor_group, &motor_pwm_freq_item);
 }
@@ -4,8 +4,21 @@
 #include <motor/svpwm.h>
 #include <menu/menu.h>
 #include <motor/mc.h>
+#include <motor/adc.h>
+#include <motor/foc.h>
+#include <motor/bldc.h>
+#include <motor/prof.h>
+
+#include <zephyr/logging/log.h>
+
+#include <string.h>
+
+LOG_MODULE_REGISTER(motor, LOG_LEVEL_INF);
 
 #define MOTOR_THREAD_STACK_SIZE 512
+#define MOTOR_RAMP_STEP_MS      10
+/* extra time after the BLDC ramp to pick up the back-EMF */
+#define MOTOR_SYNC_TIMEOUT_MS   1000
 
 struct motor_t {
     uint8_t type;
@@ -19,8 +32,20 @@ struct motor_t {
     struct k_event event;
     struct mc_t *mc;
     struct mc_adc_info *adc;
+    uint16_t curr_a;
+    uint16_t curr_c;
+    struct foc_t foc;
+    uint16_t angle;
+    uint16_t angle_step;
+    uint16_t angle_step_target;
+    struct bldc_t bldc;
+    uint32_t event_stamp;
 };
 
+#ifdef CONFIG_MC_STATIC_ALLOC
+static struct motor_t motor_pool[CONFIG_MC_MAX_MOTORS];
+#endif
+
 enum motor_state_t {
     MOTOR_STATE_IDLE,
     MOTOR_STATE_IDENTIFICATION,
@@ -31,10 +56,91 @@ enum motor_state_t {
     MOTOR_STATE_FAULT,
 };
 
+static bool motor_wait_idle(struct motor_t *motor, k_timeout_t timeout)
+{
+    return k_event_wait(&motor->event, MOTOR_EVENT_IDLE, false, timeout) != 0;
+}
+
+static void motor_pwm_apply(struct motor_t *motor, const uint16_t duty[3])
+{
+    PROF_START(start);
+    uint32_t period = svpwm_period_get(motor->svpwm);
+    int i;
+
+    for (i = 0; i < 3; i++)
+    {
+        svpwm_update_pulse(motor->svpwm, i, ((uint32_t)duty[i] * period) >> 15);
+    }
+
+    PROF_STOP(PROF_PWM_UPDATE, start);
+}
+
+/*
+ * Calls per second of motor_current_update: once per PWM period with the
+ * injected sequence, once per regular scan without it.
+ */
+static uint32_t motor_control_freq(struct motor_t *motor)
+{
+#ifdef CONFIG_MC_ADC_CURRENT_INJECTED
+    return svpwm_freq_get(motor->svpwm);
+#else
+    return USEC_PER_SEC / CONFIG_MC_ADC_SCAN_INTERVAL_US;
+#endif
+}
+
+static bool motor_start(struct motor_t *motor)
+{
+    uint32_t control_freq;
+
+    if (!motor->svpwm || svpwm_freq_set(motor->svpwm, motor->freq))
+    {
+        LOG_ERR("motor %d: pwm %d Hz unavailable", motor->id, motor->freq);
+        return false;
+    }
+
+    k_event_clear(&motor->event, MOTOR_EVENT_SYNC | MOTOR_EVENT_STALL);
+
+    if (motor->type == MOTOR_TYPE_BLDC)
+    {
+        if (bldc_start(&motor->bldc, CONFIG_MC_BLDC_STARTUP_DUTY))
+        {
+            LOG_ERR("motor %d: no commutation timer", motor->id);
+            return false;
+        }
+        return true;
+    }
+
+    control_freq = motor_control_freq(motor);
+
+    foc_reset(&motor->foc);
+    motor->foc.id_ref = CONFIG_MC_FOC_ALIGN_CURRENT;
+    motor->angle = 0;
+    motor->angle_step = 0;
+    motor->angle_step_target = ((uint32_t)CONFIG_MC_FOC_OPEN_LOOP_HZ << 16) / control_freq;
+
+    motor_pwm_apply(motor, motor->foc.duty);
+    svpwm_enable(motor->svpwm, true);
+
+    return true;
+}
+
+static void motor_stop(struct motor_t *motor)
+{
+    static const uint16_t duty_off[3] = { 0, 0, 0 };
+
+    if (!motor->svpwm)
+        return;
+
+    bldc_stop(&motor->bldc);
+    svpwm_enable(motor->svpwm, false);
+    motor_pwm_apply(motor, duty_off);
+}
+
 static void motor_thread_func(void *v1, void *v2, void *v3)
 {
     struct motor_t *motor = v1;
-    int ret;
+    uint16_t ramp_inc;
+    uint32_t ret;
 
     while(true)
     {
@@ -42,22 +148,91 @@ static void motor_thread_func(void *v1, void *v2, void *v3)
         {
             case MOTOR_STATE_IDLE:
                 ret = k_event_wait(&motor->event, MOTOR_EVENT_READY, false, K_FOREVER);
-                if (ret == 0)
+                prof_record(PROF_MOTOR_WAKE, prof_now() - motor->event_stamp);
+                k_event_clear(&motor->event, MOTOR_EVENT_READY | MOTOR_EVENT_IDLE);
+                if (ret && motor_start(motor))
                 {
-
+                    motor->state = MOTOR_STATE_ALIGNMENT;
                 }
                 break;
             case MOTOR_STATE_IDENTIFICATION:
+                motor->state = MOTOR_STATE_ALIGNMENT;
                 break;
             case MOTOR_STATE_ALIGNMENT:
+                if (motor->type == MOTOR_TYPE_BLDC)
+                {
+                    /* hold the rotor on the first step */
+                    if (motor_wait_idle(motor, K_MSEC(CONFIG_MC_BLDC_ALIGN_MS)))
+                    {
+                        motor->state = MOTOR_STATE_STOPPING;
+                        break;
+                    }
+                    bldc_ramp_start(&motor->bldc);
+                    motor->state = MOTOR_STATE_STARTUP;
+                    break;
+                }
+                /* hold the rotor on angle 0 with d-axis current */
+                if (motor_wait_idle(motor, K_MSEC(CONFIG_MC_FOC_ALIGN_MS)))
+                {
+                    motor->state = MOTOR_STATE_STOPPING;
+                    break;
+                }
+                motor->foc.id_ref = 0;
+                motor->foc.iq_ref = CONFIG_MC_FOC_STARTUP_CURRENT;
+                motor->state = MOTOR_STATE_STARTUP;
                 break;
             case MOTOR_STATE_STARTUP:
+                if (motor->type == MOTOR_TYPE_BLDC)
+                {
+                    /* forced commutation ramp until the back-EMF is tracked */
+                    ret = k_event_wait(&motor->event, MOTOR_EVENT_IDLE | MOTOR_EVENT_SYNC | MOTOR_EVENT_STALL, false,
+                                       K_MSEC(CONFIG_MC_BLDC_RAMP_MS + MOTOR_SYNC_TIMEOUT_MS));
+                    if (ret & MOTOR_EVENT_IDLE)
+                    {
+                        motor->state = MOTOR_STATE_STOPPING;
+                    } else if (ret & MOTOR_EVENT_SYNC) {
+                        motor->state = MOTOR_STATE_RUN;
+                    } else {
+                        LOG_WRN("motor %d: no back-EMF sync", motor->id);
+                        motor->state = MOTOR_STATE_FAULT;
+                    }
+                    break;
+                }
+                /* open-loop current/frequency ramp */
+                if (motor_wait_idle(motor, K_MSEC(MOTOR_RAMP_STEP_MS)))
+                {
+                    motor->state = MOTOR_STATE_STOPPING;
+                    break;
+                }
+                ramp_inc = MAX(1, motor->angle_step_target * MOTOR_RAMP_STEP_MS / CONFIG_MC_FOC_RAMP_MS);
+                if (motor->angle_step + ramp_inc < motor->angle_step_target)
+                {
+                    motor->angle_step += ramp_inc;
+                } else {
+                    motor->angle_step = motor->angle_step_target;
+                    motor->state = MOTOR_STATE_RUN;
+                }
                 break;
             case MOTOR_STATE_RUN:
+                ret = k_event_wait(&motor->event, MOTOR_EVENT_IDLE | MOTOR_EVENT_STALL, false, K_FOREVER);
+                if (!(ret & MOTOR_EVENT_IDLE))
+                {
+                    LOG_WRN("motor %d: stalled", motor->id);
+                    motor->state = MOTOR_STATE_FAULT;
+                    break;
+                }
+                motor->state = MOTOR_STATE_STOPPING;
                 break;
             case MOTOR_STATE_STOPPING:
+                motor_stop(motor);
+                k_event_clear(&motor->event, MOTOR_EVENT_READY | MOTOR_EVENT_IDLE);
+                motor->state = MOTOR_STATE_IDLE;
                 break;
             case MOTOR_STATE_FAULT:
+                motor_stop(motor);
+                motor_wait_idle(motor, K_FOREVER);
+                k_event_clear(&motor->event, MOTOR_EVENT_READY | MOTOR_EVENT_IDLE);
+                motor->state = MOTOR_STATE_IDLE;
                 break;
         }
     }
@@ -65,12 +240,28 @@ static void motor_thread_func(void *v1, void *v2, void *v3)
 
 struct motor_t *motor_init(struct mc_t *mc, struct mc_adc_info *adc, uint8_t type, uint8_t id)
 {
-    struct motor_t *motor = k_malloc(sizeof(*motor));
+    struct motor_t *motor;
+
+#ifdef CONFIG_MC_STATIC_ALLOC
+    if (id >= CONFIG_MC_MAX_MOTORS)
+        return NULL;
+
+    motor = &motor_pool[id];
+#else
+    motor = k_malloc(sizeof(*motor));
+    if (!motor)
+        return NULL;
+#endif
+
+    memset(motor, 0, sizeof(*motor));
     motor->type = type;
     motor->id = id;
     motor->state = MOTOR_STATE_IDLE;
     motor->mc = mc;
     motor->adc = adc;
+    motor->freq = CONFIG_MC_PWM_FREQ_HZ;
+
+    foc_init(&motor->foc, CONFIG_MC_FOC_KP, CONFIG_MC_FOC_KI);
 
     k_event_init(&motor->event);
 
@@ -86,6 +277,11 @@ int motor_svpwm_init(struct motor_t *motor, const struct svpwm_info *info)
     return motor->svpwm ? 0 : -ENODEV;
 }
 
+int motor_bldc_init(struct motor_t *motor, const struct device *timer)
+{
+    return bldc_init(&motor->bldc, timer, motor->svpwm, motor->mc, motor->adc, &motor->event);
+}
+
 void motor_type_change_cb(struct menu_item_t *item, uint8_t type)
 {
     struct mc_t *mc = menu_driver_get(item->menu);
@@ -142,10 +338,58 @@ void motor_svpwm_freq_set_cb(struct menu_item_t *item, int32_t min, int32_t max)
 
 void motor_ready(struct motor_t *motor)
 {
+    motor->event_stamp = prof_now();
     k_event_post(&motor->event, MOTOR_EVENT_READY);
 }
 
 void motor_idle(struct motor_t *motor)
 {
+    motor->event_stamp = prof_now();
     k_event_post(&motor->event, MOTOR_EVENT_IDLE);
+}
+
+/* called from interrupt context with the PWM-synchronized phase currents */
+void motor_current_update(struct motor_t *motor, const struct adc_current_samples *samples)
+{
+    PROF_START(start);
+
+    motor->curr_a = samples->curr_a;
+    motor->curr_c = samples->curr_c;
+
+    if (motor->type == MOTOR_TYPE_BLDC)
+    {
+        bldc_bemf_update(&motor->bldc, samples->aux);
+        PROF_STOP(PROF_CONTROL_LOOP, start);
+        return;
+    }
+
+    switch (motor->state)
+    {
+        case MOTOR_STATE_ALIGNMENT:
+        case MOTOR_STATE_STARTUP:
+        case MOTOR_STATE_RUN:
+            break;
+        default:
+            return;
+    }
+
+    motor->angle += motor->angle_step;
+
+    foc_step(&motor->foc,
+             foc_current_q15(samples->curr_a, motor->adc[CURR_A].calib.offset),
+             foc_current_q15(samples->curr_c, motor->adc[CURR_C].calib.offset),
+             motor->angle);
+
+    motor_pwm_apply(motor, motor->foc.duty);
+
+    PROF_STOP(PROF_CONTROL_LOOP, start);
+}
+
+/* electrical rpm */
+uint32_t motor_speed_get(struct motor_t *motor)
+{
+    if (motor->type == MOTOR_TYPE_BLDC)
+        return bldc_speed_get(&motor->bldc);
+
+    return ((uint64_t)motor->angle_step * motor_control_freq(motor) * 60) >> 16;
 }
\ No newline at end of file
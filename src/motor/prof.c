@@ -0,0 +1,174 @@
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+
+#include <motor/prof.h>
+
+#include <string.h>
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+#include <cmsis_core.h>
+#endif
+
+struct prof_stat {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    /* bin n counts samples below 2^n cycles, the last bin takes the rest */
+    uint32_t hist[PROF_HIST_BINS];
+};
+
+static const char *const prof_names[PROF_COUNT] = {
+    [PROF_ADC_SCAN] = "adc_scan",
+    [PROF_ADC_DISPATCH] = "adc_dispatch",
+    [PROF_ADC_CALLBACK] = "adc_callback",
+    [PROF_CURRENT_ISR] = "current_isr",
+    [PROF_CONTROL_LOOP] = "control_loop",
+    [PROF_FOC_STEP] = "foc_step",
+    [PROF_PWM_UPDATE] = "pwm_update",
+    [PROF_MOTOR_WAKE] = "motor_wake",
+};
+
+static struct prof_stat prof_stats[PROF_COUNT];
+
+uint32_t prof_now(void)
+{
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+    return DWT->CYCCNT;
+#else
+    return k_cycle_get_32();
+#endif
+}
+
+static uint32_t prof_freq(void)
+{
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+    return SystemCoreClock;
+#else
+    return sys_clock_hw_cycles_per_sec();
+#endif
+}
+
+void prof_record(enum prof_probe probe, uint32_t cycles)
+{
+    struct prof_stat *stat = &prof_stats[probe];
+    unsigned int key;
+    uint8_t bin;
+
+    bin = cycles ? 32 - __builtin_clz(cycles) : 0;
+    bin = MIN(bin, PROF_HIST_BINS - 1);
+
+    key = irq_lock();
+
+    if (!stat->count || cycles < stat->min)
+        stat->min = cycles;
+    if (cycles > stat->max)
+        stat->max = cycles;
+    stat->count++;
+    stat->sum += cycles;
+    stat->hist[bin]++;
+
+    irq_unlock(key);
+}
+
+void prof_reset(void)
+{
+    unsigned int key = irq_lock();
+
+    memset(prof_stats, 0, sizeof(prof_stats));
+
+    irq_unlock(key);
+}
+
+static int prof_init(void)
+{
+#ifdef CONFIG_CPU_CORTEX_M_HAS_DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    return 0;
+}
+
+SYS_INIT(prof_init, PRE_KERNEL_2, 0);
+
+#ifdef CONFIG_SHELL
+static int cmd_prof_show(const struct shell *sh, size_t argc, char **argv)
+{
+    struct prof_stat stat;
+    uint32_t mhz = MAX(prof_freq() / 1000000, 1);
+    unsigned int key;
+    int i;
+
+    shell_print(sh, "%-13s %8s %8s %8s %8s  (cycles, %u MHz)", "probe", "count", "min", "avg", "max", mhz);
+
+    for (i = 0; i < PROF_COUNT; i++)
+    {
+        key = irq_lock();
+        stat = prof_stats[i];
+        irq_unlock(key);
+
+        if (!stat.count)
+        {
+            shell_print(sh, "%-13s %8u", prof_names[i], 0);
+            continue;
+        }
+
+        shell_print(sh, "%-13s %8u %8u %8u %8u", prof_names[i], stat.count, stat.min,
+                    (uint32_t)(stat.sum / stat.count), stat.max);
+    }
+
+    return 0;
+}
+
+static int cmd_prof_hist(const struct shell *sh, size_t argc, char **argv)
+{
+    struct prof_stat stat;
+    unsigned int key;
+    int i, probe;
+
+    for (probe = 0; probe < PROF_COUNT; probe++)
+    {
+        if (!strcmp(argv[1], prof_names[probe]))
+            break;
+    }
+
+    if (probe == PROF_COUNT)
+    {
+        shell_error(sh, "unknown probe %s", argv[1]);
+        return -EINVAL;
+    }
+
+    key = irq_lock();
+    stat = prof_stats[probe];
+    irq_unlock(key);
+
+    for (i = 0; i < PROF_HIST_BINS; i++)
+    {
+        if (stat.hist[i])
+            shell_print(sh, "%s%6u cycles: %u", i == PROF_HIST_BINS - 1 ? ">=" : " <",
+                        i == PROF_HIST_BINS - 1 ? BIT(i - 1) : BIT(i), stat.hist[i]);
+    }
+
+    return 0;
+}
+
+static int cmd_prof_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    prof_reset();
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(prof_cmds,
+    SHELL_CMD(show, NULL, "Show min/avg/max per probe", cmd_prof_show),
+    SHELL_CMD_ARG(hist, NULL, "Show the cycle histogram of a probe", cmd_prof_hist, 2, 0),
+    SHELL_CMD(reset, NULL, "Clear all probes", cmd_prof_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(prof, &prof_cmds, "Control loop profiling", NULL);
+#endif
@@ -0,0 +1,68 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include <motor/ring.h>
+
+#include <errno.h>
+
+int ring_init(struct ring_t *ring, uint16_t *buf, uint32_t size)
+{
+    if (!buf || !size || !IS_POWER_OF_TWO(size))
+        return -EINVAL;
+
+    ring->buf = buf;
+    ring->mask = size - 1;
+    atomic_set(&ring->head, 0);
+    atomic_set(&ring->tail, 0);
+    atomic_set(&ring->overrun, 0);
+
+    return 0;
+}
+
+/* producer side, callable from interrupt context */
+bool ring_put(struct ring_t *ring, uint16_t value)
+{
+    uint32_t head = atomic_get(&ring->head);
+    uint32_t tail = atomic_get(&ring->tail);
+
+    if (head - tail > ring->mask)
+    {
+        atomic_inc(&ring->overrun);
+        return false;
+    }
+
+    ring->buf[head & ring->mask] = value;
+
+    /* publish the slot only once it holds the sample */
+    atomic_set(&ring->head, head + 1);
+
+    return true;
+}
+
+/* consumer side, copies out up to max samples, oldest first */
+size_t ring_get(struct ring_t *ring, uint16_t *out, size_t max)
+{
+    uint32_t tail = atomic_get(&ring->tail);
+    uint32_t head = atomic_get(&ring->head);
+    size_t n = MIN(head - tail, max);
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        out[i] = ring->buf[(tail + i) & ring->mask];
+    }
+
+    atomic_set(&ring->tail, tail + n);
+
+    return n;
+}
+
+size_t ring_count(struct ring_t *ring)
+{
+    return (uint32_t)atomic_get(&ring->head) - (uint32_t)atomic_get(&ring->tail);
+}
+
+uint32_t ring_overrun_get(struct ring_t *ring)
+{
+    return atomic_get(&ring->overrun);
+}
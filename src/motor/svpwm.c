@@ -6,6 +6,7 @@
 #include <motor/svpwm.h>
 
 #include <errno.h>
+#include <string.h>
 
 LOG_MODULE_REGISTER(svpwm, LOG_LEVEL_INF);
 
@@ -18,6 +19,11 @@ struct svpwm_t {
     uint64_t cycles_per_sec;
 };
 
+#ifdef CONFIG_MC_STATIC_ALLOC
+static struct svpwm_t svpwm_pool[CONFIG_MC_MAX_MOTORS];
+static uint8_t svpwm_used;
+#endif
+
 struct svpwm_t *svpwm_init(const struct svpwm_info *info)
 {
     struct svpwm_t *svpwm;
@@ -30,13 +36,30 @@ struct svpwm_t *svpwm_init(const struct svpwm_info *info)
         return NULL;
     }
     
+#ifdef CONFIG_MC_STATIC_ALLOC
+    if (svpwm_used >= ARRAY_SIZE(svpwm_pool))
+    {
+        LOG_ERR("no free pwm instance");
+        return NULL;
+    }
+    svpwm = &svpwm_pool[svpwm_used++];
+#else
     svpwm = k_malloc(sizeof(*svpwm));
+    if (!svpwm)
+    {
+        return NULL;
+    }
+#endif
+
+    memset(svpwm, 0, sizeof(*svpwm));
     svpwm->info = info;
+    svpwm->freq_min = 1;
+    svpwm->freq_max = UINT16_MAX;
 
     for (i = 0; i < info->nb_channels; i++)
     {
         ch = &info->channels[i];
-        gpio_pin_set_dt(&ch->en, 0);
+        gpio_pin_configure_dt(&ch->en, GPIO_OUTPUT_INACTIVE);
         svpwm->pulse[i] = 0;
     }
 
@@ -122,8 +145,6 @@ void svpwm_freq_set_range(struct svpwm_t *pwm, uint16_t min, uint16_t max)
         return;
     }
 
-    pwm->freq_min = period_cycles;
-
     period_cycles = (uint32_t)(pwm->cycles_per_sec / max);
     if (period_cycles > 65535) {
         uint32_t prescaler = (period_cycles / 65535) + 1;
@@ -132,5 +153,31 @@ void svpwm_freq_set_range(struct svpwm_t *pwm, uint16_t min, uint16_t max)
         return;
     }
 
-    pwm->freq_max = period_cycles;
+    pwm->freq_min = min;
+    pwm->freq_max = max;
+}
+
+uint32_t svpwm_period_get(struct svpwm_t *pwm)
+{
+    return pwm->freq_curr;
+}
+
+uint32_t svpwm_freq_get(struct svpwm_t *pwm)
+{
+    return pwm->freq_curr ? pwm->cycles_per_sec / pwm->freq_curr : 0;
+}
+
+void svpwm_channel_enable(struct svpwm_t *pwm, uint8_t channel, bool enable)
+{
+    gpio_pin_set_dt(&pwm->info->channels[channel].en, enable);
+}
+
+void svpwm_enable(struct svpwm_t *pwm, bool enable)
+{
+    int i;
+
+    for (i = 0; i < pwm->info->nb_channels; i++)
+    {
+        svpwm_channel_enable(pwm, i, enable);
+    }
 }
\ No newline at end of file
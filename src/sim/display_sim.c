@@ -0,0 +1,137 @@
+#define DT_DRV_COMPAT motor_display_sim
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/display.h>
+#include <zephyr/sys/crc.h>
+
+#include <sim/display_sim.h>
+
+#include <string.h>
+
+struct display_sim_config {
+    uint16_t width;
+    uint16_t height;
+    uint8_t *fb;
+};
+
+struct display_sim_data {
+    struct k_spinlock lock;
+    struct display_sim_cost frame;
+    struct display_sim_stats stats;
+};
+
+static int display_sim_write(const struct device *dev, const uint16_t x, const uint16_t y,
+                             const struct display_buffer_descriptor *desc, const void *buf)
+{
+    const struct display_sim_config *config = dev->config;
+    struct display_sim_data *data = dev->data;
+    const uint8_t *src = buf;
+    k_spinlock_key_t key;
+    uint16_t row;
+
+    if (x + desc->width > config->width || y + desc->height > config->height)
+        return -EINVAL;
+
+    for (row = 0; row < desc->height; row++)
+    {
+        memcpy(config->fb + ((y + row) * config->width + x) * 2,
+               src + row * desc->pitch * 2, desc->width * 2);
+    }
+
+    key = k_spin_lock(&data->lock);
+    data->frame.writes++;
+    data->frame.bytes += desc->width * desc->height * 2;
+    data->frame.pixels += desc->width * desc->height;
+    k_spin_unlock(&data->lock, key);
+
+    return 0;
+}
+
+static int display_sim_blanking(const struct device *dev)
+{
+    return 0;
+}
+
+static void display_sim_get_capabilities(const struct device *dev, struct display_capabilities *caps)
+{
+    const struct display_sim_config *config = dev->config;
+
+    memset(caps, 0, sizeof(*caps));
+    caps->x_resolution = config->width;
+    caps->y_resolution = config->height;
+    caps->supported_pixel_formats = PIXEL_FORMAT_RGB_565;
+    caps->current_pixel_format = PIXEL_FORMAT_RGB_565;
+    caps->current_orientation = DISPLAY_ORIENTATION_NORMAL;
+}
+
+static int display_sim_set_pixel_format(const struct device *dev, const enum display_pixel_format format)
+{
+    return format == PIXEL_FORMAT_RGB_565 ? 0 : -ENOTSUP;
+}
+
+void display_sim_frame_end(const struct device *dev)
+{
+    const struct display_sim_config *config = dev->config;
+    struct display_sim_data *data = dev->data;
+    struct display_sim_stats *stats = &data->stats;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+    if (data->frame.writes)
+    {
+        stats->frames++;
+        stats->total.writes += data->frame.writes;
+        stats->total.bytes += data->frame.bytes;
+        stats->total.pixels += data->frame.pixels;
+        stats->last = data->frame;
+        if (data->frame.pixels > stats->max.pixels)
+            stats->max = data->frame;
+        stats->crc = crc32_ieee(config->fb, config->width * config->height * 2);
+        memset(&data->frame, 0, sizeof(data->frame));
+    }
+
+    k_spin_unlock(&data->lock, key);
+}
+
+void display_sim_stats_get(const struct device *dev, struct display_sim_stats *stats)
+{
+    struct display_sim_data *data = dev->data;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+
+    *stats = data->stats;
+
+    k_spin_unlock(&data->lock, key);
+}
+
+void display_sim_stats_reset(const struct device *dev)
+{
+    struct display_sim_data *data = dev->data;
+    k_spinlock_key_t key = k_spin_lock(&data->lock);
+    uint32_t crc = data->stats.crc;
+
+    memset(&data->stats, 0, sizeof(data->stats));
+    data->stats.crc = crc;
+
+    k_spin_unlock(&data->lock, key);
+}
+
+static const struct display_driver_api display_sim_api = {
+    .blanking_on = display_sim_blanking,
+    .blanking_off = display_sim_blanking,
+    .write = display_sim_write,
+    .get_capabilities = display_sim_get_capabilities,
+    .set_pixel_format = display_sim_set_pixel_format,
+};
+
+#define DISPLAY_SIM_DEFINE(n)                                                           \
+    static uint8_t display_sim_fb_##n[DT_INST_PROP(n, width) * DT_INST_PROP(n, height) * 2]; \
+    static const struct display_sim_config display_sim_config_##n = {                   \
+        .width = DT_INST_PROP(n, width),                                                \
+        .height = DT_INST_PROP(n, height),                                              \
+        .fb = display_sim_fb_##n,                                                       \
+    };                                                                                  \
+    static struct display_sim_data display_sim_data_##n;                                \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, &display_sim_data_##n, &display_sim_config_##n, \
+                          POST_KERNEL, CONFIG_DISPLAY_INIT_PRIORITY, &display_sim_api);
+
+DT_INST_FOREACH_STATUS_OKAY(DISPLAY_SIM_DEFINE)
@@ -0,0 +1,69 @@
+#define DT_DRV_COMPAT motor_pwm_sim
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/pwm.h>
+
+#define PWM_SIM_MAX_CHANNELS 8
+
+struct pwm_sim_config {
+    uint64_t cycles_per_sec;
+    uint8_t channels;
+};
+
+struct pwm_sim_channel {
+    uint32_t period;
+    uint32_t pulse;
+    pwm_flags_t flags;
+};
+
+struct pwm_sim_data {
+    struct pwm_sim_channel channels[PWM_SIM_MAX_CHANNELS];
+    uint32_t updates;
+};
+
+static int pwm_sim_set_cycles(const struct device *dev, uint32_t channel, uint32_t period,
+                              uint32_t pulse, pwm_flags_t flags)
+{
+    const struct pwm_sim_config *config = dev->config;
+    struct pwm_sim_data *data = dev->data;
+    struct pwm_sim_channel *ch;
+
+    /* channels are numbered from 1 like the STM32 timer outputs */
+    if (channel < 1 || channel > config->channels)
+        return -EINVAL;
+
+    ch = &data->channels[channel - 1];
+    ch->period = period;
+    ch->pulse = pulse;
+    ch->flags = flags;
+    data->updates++;
+
+    return 0;
+}
+
+static int pwm_sim_get_cycles_per_sec(const struct device *dev, uint32_t channel, uint64_t *cycles)
+{
+    const struct pwm_sim_config *config = dev->config;
+
+    *cycles = config->cycles_per_sec;
+
+    return 0;
+}
+
+static const struct pwm_driver_api pwm_sim_api = {
+    .set_cycles = pwm_sim_set_cycles,
+    .get_cycles_per_sec = pwm_sim_get_cycles_per_sec,
+};
+
+#define PWM_SIM_DEFINE(n)                                                               \
+    BUILD_ASSERT(DT_INST_PROP(n, channels) <= PWM_SIM_MAX_CHANNELS);                    \
+    static const struct pwm_sim_config pwm_sim_config_##n = {                           \
+        .cycles_per_sec = DT_INST_PROP(n, clock_frequency),                             \
+        .channels = DT_INST_PROP(n, channels),                                          \
+    };                                                                                  \
+    static struct pwm_sim_data pwm_sim_data_##n;                                        \
+    DEVICE_DT_INST_DEFINE(n, NULL, NULL, &pwm_sim_data_##n, &pwm_sim_config_##n,        \
+                          POST_KERNEL, CONFIG_PWM_INIT_PRIORITY, &pwm_sim_api);
+
+DT_INST_FOREACH_STATUS_OKAY(PWM_SIM_DEFINE)
@@ -0,0 +1,90 @@
+#define DT_DRV_COMPAT motor_qdec_sim
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+
+#include <sim/qdec_sim.h>
+
+struct qdec_sim_config {
+    int32_t degrees_per_detent;
+};
+
+struct qdec_sim_data {
+    int32_t position;       /* degrees, wraps like the hardware counter */
+    int32_t sample;
+    const struct sensor_trigger *trigger;
+    sensor_trigger_handler_t handler;
+};
+
+static int qdec_sim_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+    struct qdec_sim_data *data = dev->data;
+
+    if (chan != SENSOR_CHAN_ALL && chan != SENSOR_CHAN_ROTATION)
+        return -ENOTSUP;
+
+    data->sample = data->position;
+
+    return 0;
+}
+
+static int qdec_sim_channel_get(const struct device *dev, enum sensor_channel chan, struct sensor_value *val)
+{
+    struct qdec_sim_data *data = dev->data;
+
+    if (chan != SENSOR_CHAN_ROTATION)
+        return -ENOTSUP;
+
+    val->val1 = data->sample;
+    val->val2 = 0;
+
+    return 0;
+}
+
+static int qdec_sim_trigger_set(const struct device *dev, const struct sensor_trigger *trig,
+                                sensor_trigger_handler_t handler)
+{
+    struct qdec_sim_data *data = dev->data;
+
+    if (trig->type != SENSOR_TRIG_DATA_READY)
+        return -ENOTSUP;
+
+    data->trigger = trig;
+    data->handler = handler;
+
+    return 0;
+}
+
+int qdec_sim_rotate(const struct device *dev, int32_t detents)
+{
+    const struct qdec_sim_config *config = dev->config;
+    struct qdec_sim_data *data = dev->data;
+    int32_t step = detents > 0 ? config->degrees_per_detent : -config->degrees_per_detent;
+
+    for (; detents; detents -= detents > 0 ? 1 : -1)
+    {
+        data->position = (data->position + step + 360) % 360;
+
+        if (data->handler)
+            data->handler(dev, data->trigger);
+    }
+
+    return 0;
+}
+
+static const struct sensor_driver_api qdec_sim_api = {
+    .sample_fetch = qdec_sim_sample_fetch,
+    .channel_get = qdec_sim_channel_get,
+    .trigger_set = qdec_sim_trigger_set,
+};
+
+#define QDEC_SIM_DEFINE(n)                                                              \
+    static const struct qdec_sim_config qdec_sim_config_##n = {                         \
+        .degrees_per_detent = DT_INST_PROP(n, degrees_per_detent),                      \
+    };                                                                                  \
+    static struct qdec_sim_data qdec_sim_data_##n;                                      \
+    SENSOR_DEVICE_DT_INST_DEFINE(n, NULL, NULL, &qdec_sim_data_##n, &qdec_sim_config_##n, \
+                                 POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY, &qdec_sim_api);
+
+DT_INST_FOREACH_STATUS_OKAY(QDEC_SIM_DEFINE)
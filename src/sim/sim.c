@@ -0,0 +1,125 @@
+#include <zephyr/kernel.h>
+#include <zephyr/init.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/shell/shell.h>
+
+#include <sim/display_sim.h>
+#include <sim/qdec_sim.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Bench for the native_sim board: sets the emulated ADC inputs to a sane
+ * idle state at boot and drives the keys, the knob and the analog inputs
+ * from the shell.
+ */
+
+#define SIM_ADC_NODE        DT_ALIAS(adc2)
+#define SIM_KEY_PRESS_MS    50
+
+/* pin voltages at boot: 24 V bus behind its 104.7k/4.7k divider, no phase current */
+static const struct {
+    uint8_t channel;
+    uint32_t mv;
+} sim_adc_idle[] = {
+    { DT_REG_ADDR(DT_CHILD(SIM_ADC_NODE, channel_11)), 1077 },
+    { DT_REG_ADDR(DT_CHILD(SIM_ADC_NODE, channel_3)), 1650 },
+    { DT_REG_ADDR(DT_CHILD(SIM_ADC_NODE, channel_17)), 1650 },
+};
+
+#define SIM_KEY(node) { DT_NODE_FULL_NAME(node), GPIO_DT_SPEC_GET(node, gpios) },
+
+static const struct {
+    const char *name;
+    struct gpio_dt_spec gpio;
+} sim_keys[] = {
+    DT_FOREACH_CHILD(DT_NODELABEL(buttons), SIM_KEY)
+};
+
+static int sim_init(void)
+{
+    const struct device *adc = DEVICE_DT_GET(SIM_ADC_NODE);
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(sim_adc_idle); i++)
+    {
+        adc_emul_const_value_set(adc, sim_adc_idle[i].channel, sim_adc_idle[i].mv);
+    }
+
+    return 0;
+}
+
+SYS_INIT(sim_init, POST_KERNEL, CONFIG_APPLICATION_INIT_PRIORITY);
+
+static int cmd_sim_key(const struct shell *sh, size_t argc, char **argv)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(sim_keys); i++)
+    {
+        if (!strcmp(argv[1], sim_keys[i].name))
+            break;
+    }
+
+    if (i == ARRAY_SIZE(sim_keys))
+    {
+        shell_error(sh, "unknown key %s", argv[1]);
+        return -EINVAL;
+    }
+
+    /* held longer than the gpio-keys debounce */
+    gpio_emul_input_set(sim_keys[i].gpio.port, sim_keys[i].gpio.pin, 1);
+    k_msleep(SIM_KEY_PRESS_MS);
+    gpio_emul_input_set(sim_keys[i].gpio.port, sim_keys[i].gpio.pin, 0);
+    k_msleep(SIM_KEY_PRESS_MS);
+
+    return 0;
+}
+
+static int cmd_sim_qdec(const struct shell *sh, size_t argc, char **argv)
+{
+    return qdec_sim_rotate(DEVICE_DT_GET(DT_ALIAS(qdec0)), strtol(argv[1], NULL, 0));
+}
+
+static int cmd_sim_adc(const struct shell *sh, size_t argc, char **argv)
+{
+    return adc_emul_const_value_set(DEVICE_DT_GET(SIM_ADC_NODE), strtoul(argv[1], NULL, 0),
+                                    strtoul(argv[2], NULL, 0));
+}
+
+static int cmd_sim_display(const struct shell *sh, size_t argc, char **argv)
+{
+    const struct device *dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_display));
+    struct display_sim_stats stats;
+
+    if (argc > 1 && !strcmp(argv[1], "reset"))
+    {
+        display_sim_stats_reset(dev);
+        return 0;
+    }
+
+    display_sim_stats_get(dev, &stats);
+
+    shell_print(sh, "%-6s %8s %10s %10s", "frames", "writes", "bytes", "pixels");
+    shell_print(sh, "%6u %8u %10u %10u  total", stats.frames, stats.total.writes,
+                stats.total.bytes, stats.total.pixels);
+    shell_print(sh, "%6s %8u %10u %10u  last", "", stats.last.writes, stats.last.bytes, stats.last.pixels);
+    shell_print(sh, "%6s %8u %10u %10u  max", "", stats.max.writes, stats.max.bytes, stats.max.pixels);
+    shell_print(sh, "framebuffer crc %08x", stats.crc);
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sim_cmds,
+    SHELL_CMD_ARG(key, NULL, "Press and release a key by its node name", cmd_sim_key, 2, 0),
+    SHELL_CMD_ARG(qdec, NULL, "Turn the knob by <detents>, negative turns back", cmd_sim_qdec, 2, 0),
+    SHELL_CMD_ARG(adc, NULL, "Set ADC <channel> input to <mV>", cmd_sim_adc, 3, 0),
+    SHELL_CMD_ARG(display, NULL, "Show display cost per frame, \"reset\" clears it", cmd_sim_display, 1, 1),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(sim, &sim_cmds, "native_sim peripherals", NULL);
@@ -0,0 +1,100 @@
+#include <zephyr/ztest.h>
+#include <zephyr/kernel.h>
+
+#include <motor/angle.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#define TABLE_BITS      CONFIG_MC_SINCOS_TABLE_BITS
+
+/*
+ * Linear interpolation between table entries is off by at most
+ * step^2 / 8 of the amplitude, step = 2 pi / entries, plus the rounding
+ * of the table, of the interpolation and of the reference.
+ */
+#define TABLE_ERR_MAX   ((int32_t)(32767.0 * M_PI * M_PI / 2 / (1 << (2 * TABLE_BITS))) + 2)
+
+#define BENCH_CALLS     4096
+
+static int16_t ref_q15(float x)
+{
+    return (int16_t)lroundf(x * 32767.0f);
+}
+
+ZTEST(angle, test_table_accuracy)
+{
+    int32_t err, err_max = 0;
+    uint32_t angle, worst = 0;
+    int16_t s, c;
+    float theta;
+
+    /* every angle, so the middle of each interval is hit */
+    for (angle = 0; angle < 65536; angle++)
+    {
+        angle_sincos_table(angle, &s, &c);
+        theta = 2.0f * (float)M_PI * angle / 65536.0f;
+
+        err = MAX(abs(s - ref_q15(sinf(theta))), abs(c - ref_q15(cosf(theta))));
+        if (err > err_max)
+        {
+            err_max = err;
+            worst = angle;
+        }
+    }
+
+    TC_PRINT("%d entries: max err %d LSB at angle %u\n", 1 << TABLE_BITS, err_max, worst);
+    zassert_true(err_max <= TABLE_ERR_MAX, "max err %d > %d LSB", err_max, TABLE_ERR_MAX);
+}
+
+ZTEST(angle, test_table_quadrants)
+{
+    static const struct {
+        uint16_t angle;
+        int16_t sin;
+        int16_t cos;
+    } points[] = {
+        { 0x0000, 0, 32767 },
+        { 0x4000, 32767, 0 },
+        { 0x8000, 0, -32767 },
+        { 0xc000, -32767, 0 },
+    };
+    int16_t s, c;
+    int i;
+
+    /* table entries, no interpolation */
+    for (i = 0; i < ARRAY_SIZE(points); i++)
+    {
+        angle_sincos_table(points[i].angle, &s, &c);
+        zassert_equal(s, points[i].sin, "sin at 0x%04x", points[i].angle);
+        zassert_equal(c, points[i].cos, "cos at 0x%04x", points[i].angle);
+    }
+}
+
+ZTEST(angle, test_fast_sincos_bench)
+{
+    volatile int16_t sink;
+    uint32_t start, cycles;
+    int16_t s, c;
+    int i;
+
+    /* the cycle count only means something on hardware */
+    start = k_cycle_get_32();
+    for (i = 0; i < BENCH_CALLS; i++)
+    {
+        fast_sincos(i * 16, &s, &c);
+        sink = s + c;
+    }
+    cycles = k_cycle_get_32() - start;
+    (void)sink;
+
+    TC_PRINT("fast_sincos: %u cycles/call\n", cycles / BENCH_CALLS);
+}
+
+static void *angle_setup(void)
+{
+    angle_init();
+    return NULL;
+}
+
+ZTEST_SUITE(angle, NULL, angle_setup, NULL, NULL, NULL);
@@ -0,0 +1,179 @@
+#include <zephyr/ztest.h>
+
+#include <motor/foc.h>
+#include <motor/angle.h>
+
+#include <math.h>
+
+#define Q15(x)          ((int16_t)lroundf((x) * 32767.0f))
+#define DEG(x)          ((uint16_t)((x) * 65536 / 360))
+#define Q15_HALF        16384
+
+/* a few LSB of truncation per transform */
+#define TRANSFORM_TOL   3
+
+static void phase_currents(float theta, float amp, int16_t *ia, int16_t *ic)
+{
+    *ia = Q15(amp * cosf(theta));
+    *ic = Q15(amp * cosf(theta + 2.0f * (float)M_PI / 3.0f));
+}
+
+ZTEST(foc, test_current_q15)
+{
+    /* 16 LSB of Q15 per ADC count around the offset */
+    zassert_equal(foc_current_q15(2048, 2048), 0);
+    zassert_equal(foc_current_q15(2049, 2048), 16);
+    zassert_equal(foc_current_q15(2047, 2048), -16);
+
+    /* an offset off mid-scale must not wrap at either end */
+    zassert_equal(foc_current_q15(4095, 2000), INT16_MAX);
+    zassert_equal(foc_current_q15(0, 2100), INT16_MIN);
+    zassert_equal(foc_current_q15(0, 2000), -32000);
+}
+
+ZTEST(foc, test_clarke)
+{
+    int16_t ia, ic, alpha, beta;
+    float theta;
+    int i;
+
+    /* a balanced set of amplitude 0.5 gives a vector of the same length */
+    for (i = 0; i < 360; i += 15)
+    {
+        theta = (float)M_PI * i / 180.0f;
+        phase_currents(theta, 0.5f, &ia, &ic);
+        foc_clarke(ia, ic, &alpha, &beta);
+
+        zassert_within(alpha, Q15(0.5f * cosf(theta)), TRANSFORM_TOL, "alpha at %d deg", i);
+        zassert_within(beta, Q15(0.5f * sinf(theta)), TRANSFORM_TOL, "beta at %d deg", i);
+    }
+}
+
+ZTEST(foc, test_park)
+{
+    int16_t sin, cos, d, q;
+
+    /* a vector along alpha is all d at 0 degrees and all -q at 90 */
+    fast_sincos(DEG(0), &sin, &cos);
+    foc_park(Q15(0.5f), 0, sin, cos, &d, &q);
+    zassert_within(d, Q15(0.5f), TRANSFORM_TOL);
+    zassert_within(q, 0, TRANSFORM_TOL);
+
+    fast_sincos(DEG(90), &sin, &cos);
+    foc_park(Q15(0.5f), 0, sin, cos, &d, &q);
+    zassert_within(d, 0, TRANSFORM_TOL);
+    zassert_within(q, Q15(-0.5f), TRANSFORM_TOL);
+}
+
+ZTEST(foc, test_park_round_trip)
+{
+    int16_t sin, cos, alpha, beta, d, q;
+    float theta;
+    int i;
+
+    /* exact sin/cos, the table error is covered by the angle tests */
+    for (i = 0; i < 360; i += 7)
+    {
+        theta = (float)M_PI * i / 180.0f;
+        sin = Q15(sinf(theta));
+        cos = Q15(cosf(theta));
+        foc_inv_park(Q15(0.2f), Q15(-0.4f), sin, cos, &alpha, &beta);
+        foc_park(alpha, beta, sin, cos, &d, &q);
+
+        zassert_within(d, Q15(0.2f), 2 * TRANSFORM_TOL, "d at %d deg", i);
+        zassert_within(q, Q15(-0.4f), 2 * TRANSFORM_TOL, "q at %d deg", i);
+    }
+}
+
+ZTEST(foc, test_pi)
+{
+    struct foc_pi pi = {
+        .kp = 1 << FOC_PI_SHIFT,
+        .ki = 1 << (FOC_PI_SHIFT - 2),
+        .out_min = -10000,
+        .out_max = 10000,
+    };
+    int16_t out;
+    int i;
+
+    /* proportional part plus a quarter of the error per period */
+    zassert_equal(foc_pi_run(&pi, 1000), 1250);
+    zassert_equal(foc_pi_run(&pi, 1000), 1500);
+
+    for (i = 0; i < 100; i++)
+    {
+        out = foc_pi_run(&pi, 1000);
+    }
+    zassert_equal(out, 10000, "output not clamped");
+    zassert_equal(pi.integral, 10000 << FOC_PI_SHIFT, "integral wound up");
+
+    /* no windup: a reversed error acts on the very next period */
+    zassert_equal(foc_pi_run(&pi, -1000), 10000 - 250 - 1000);
+
+    for (i = 0; i < 100; i++)
+    {
+        out = foc_pi_run(&pi, -1000);
+    }
+    zassert_equal(out, -10000);
+}
+
+ZTEST(foc, test_svpwm_sectors)
+{
+    uint16_t duty[3];
+    int16_t v[3];
+    uint8_t sector;
+    float theta;
+    int i, k;
+
+    /* the vector in the middle of each sector */
+    for (k = 1; k <= 6; k++)
+    {
+        theta = (float)M_PI * (30 + 60 * (k - 1)) / 180.0f;
+        sector = foc_svpwm(Q15(0.5f * cosf(theta)), Q15(0.5f * sinf(theta)), duty);
+        zassert_equal(sector, k, "vector at %d deg", 30 + 60 * (k - 1));
+
+        /* centered: phase to phase voltages kept, max and min around half */
+        for (i = 0; i < 3; i++)
+        {
+            v[i] = Q15(0.5f * cosf(theta - 2.0f * (float)M_PI * i / 3.0f));
+        }
+        zassert_within(duty[0] - duty[1], v[0] - v[1], TRANSFORM_TOL);
+        zassert_within(duty[1] - duty[2], v[1] - v[2], TRANSFORM_TOL);
+        zassert_within(MAX(duty[0], MAX(duty[1], duty[2])) +
+                       MIN(duty[0], MIN(duty[1], duty[2])), 2 * Q15_HALF, TRANSFORM_TOL);
+    }
+}
+
+ZTEST(foc, test_svpwm_zero_vector)
+{
+    uint16_t duty[3];
+
+    zassert_equal(foc_svpwm(0, 0, duty), 0);
+    zassert_equal(duty[0], Q15_HALF);
+    zassert_equal(duty[1], Q15_HALF);
+    zassert_equal(duty[2], Q15_HALF);
+}
+
+ZTEST(foc, test_step_idle)
+{
+    struct foc_t foc;
+
+    /* no current and no reference keeps all phases at half duty */
+    foc_init(&foc, 1 << FOC_PI_SHIFT, 1 << (FOC_PI_SHIFT - 4));
+    foc_step(&foc, 0, 0, DEG(45));
+
+    zassert_equal(foc.v_d, 0);
+    zassert_equal(foc.v_q, 0);
+    zassert_equal(foc.sector, 0);
+    zassert_equal(foc.duty[0], Q15_HALF);
+    zassert_equal(foc.duty[1], Q15_HALF);
+    zassert_equal(foc.duty[2], Q15_HALF);
+}
+
+static void *foc_setup(void)
+{
+    angle_init();
+    return NULL;
+}
+
+ZTEST_SUITE(foc, NULL, foc_setup, NULL, NULL, NULL);